@@ -0,0 +1,141 @@
+#ifndef AABB_BATCH_H
+#define AABB_BATCH_H
+
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Tests one box against many at once. The targets are packed as separate x,
+// y, width and height float arrays, so a vector kernel can load eight (AVX2)
+// or four (SSE) of each with one instruction and compare them all without a
+// branch. Overlap follows the same strict rule as GameObject::collidesWith:
+// boxes that only touch do not overlap.
+//
+// bestAabbKernel() picks a kernel at run time from what the CPU supports, so
+// one binary uses AVX2 where it can and still runs everywhere else.
+//
+// Only the benchmark calls these for now. The game finds a ball's candidate
+// blocks through a spatial grid, which leaves a few scattered through memory:
+// gathering them into packed arrays would cost more than the scalar test,
+// and testing a whole row instead of the grid's few is slower.
+
+enum AabbKernel { AABB_SCALAR, AABB_SSE, AABB_AVX2 };
+
+// Every kernel: sets bit i % 32 of mask[i / 32] when target i overlaps the
+// box (x, y, w, h) and clears it otherwise. mask needs (count + 31) / 32
+// words. Returns how many targets overlap.
+typedef int (*AabbOverlapFn)(float x, float y, float w, float h, const float* xs, const float* ys,
+                             const float* ws, const float* hs, int count, uint32_t* mask);
+
+inline int overlapMaskScalar(float x, float y, float w, float h, const float* xs, const float* ys,
+                             const float* ws, const float* hs, int count, uint32_t* mask) {
+    float right = x + w, bottom = y + h;
+    int hits = 0;
+    for (int word = 0; word * 32 < count; word++) {
+        uint32_t bits = 0;
+        int end = count - word * 32 < 32 ? count - word * 32 : 32;
+        for (int j = 0; j < end; j++) {
+            int i = word * 32 + j;
+            bool overlap = x < xs[i] + ws[i] && right > xs[i] && y < ys[i] + hs[i] && bottom > ys[i];
+            bits |= static_cast<uint32_t>(overlap) << j;
+        }
+        mask[word] = bits;
+        hits += __builtin_popcount(bits);
+    }
+    return hits;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Four targets per step, eight steps to a mask word, built up in a register.
+// Targets past the last whole word go through the scalar test.
+__attribute__((target("sse"))) inline int overlapMaskSse(float x, float y, float w, float h, const float* xs,
+                                                         const float* ys, const float* ws, const float* hs,
+                                                         int count, uint32_t* mask) {
+    __m128 left = _mm_set1_ps(x), right = _mm_set1_ps(x + w);
+    __m128 top = _mm_set1_ps(y), bottom = _mm_set1_ps(y + h);
+    int words = count / 32;
+    int hits = 0;
+    for (int word = 0; word < words; word++) {
+        uint32_t bits = 0;
+        for (int j = 0; j < 32; j += 4) {
+            int i = word * 32 + j;
+            __m128 tx = _mm_loadu_ps(xs + i), ty = _mm_loadu_ps(ys + i);
+            __m128 overlapX = _mm_and_ps(_mm_cmplt_ps(left, _mm_add_ps(tx, _mm_loadu_ps(ws + i))), _mm_cmpgt_ps(right, tx));
+            __m128 overlapY = _mm_and_ps(_mm_cmplt_ps(top, _mm_add_ps(ty, _mm_loadu_ps(hs + i))), _mm_cmpgt_ps(bottom, ty));
+            bits |= static_cast<uint32_t>(_mm_movemask_ps(_mm_and_ps(overlapX, overlapY))) << j;
+        }
+        mask[word] = bits;
+        hits += __builtin_popcount(bits);
+    }
+    int done = words * 32;
+    if (done < count) {
+        hits += overlapMaskScalar(x, y, w, h, xs + done, ys + done, ws + done, hs + done, count - done, mask + words);
+    }
+    return hits;
+}
+
+// As overlapMaskSse, eight targets per step
+__attribute__((target("avx2"))) inline int overlapMaskAvx2(float x, float y, float w, float h, const float* xs,
+                                                           const float* ys, const float* ws, const float* hs,
+                                                           int count, uint32_t* mask) {
+    __m256 left = _mm256_set1_ps(x), right = _mm256_set1_ps(x + w);
+    __m256 top = _mm256_set1_ps(y), bottom = _mm256_set1_ps(y + h);
+    int words = count / 32;
+    int hits = 0;
+    for (int word = 0; word < words; word++) {
+        uint32_t bits = 0;
+        for (int j = 0; j < 32; j += 8) {
+            int i = word * 32 + j;
+            __m256 tx = _mm256_loadu_ps(xs + i), ty = _mm256_loadu_ps(ys + i);
+            __m256 overlapX = _mm256_and_ps(_mm256_cmp_ps(left, _mm256_add_ps(tx, _mm256_loadu_ps(ws + i)), _CMP_LT_OQ),
+                                            _mm256_cmp_ps(right, tx, _CMP_GT_OQ));
+            __m256 overlapY = _mm256_and_ps(_mm256_cmp_ps(top, _mm256_add_ps(ty, _mm256_loadu_ps(hs + i)), _CMP_LT_OQ),
+                                            _mm256_cmp_ps(bottom, ty, _CMP_GT_OQ));
+            bits |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_and_ps(overlapX, overlapY))) << j;
+        }
+        mask[word] = bits;
+        hits += __builtin_popcount(bits);
+    }
+    int done = words * 32;
+    if (done < count) {
+        hits += overlapMaskScalar(x, y, w, h, xs + done, ys + done, ws + done, hs + done, count - done, mask + words);
+    }
+    return hits;
+}
+
+#endif
+
+inline bool aabbKernelSupported(AabbKernel kernel) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (kernel == AABB_AVX2) return __builtin_cpu_supports("avx2");
+    if (kernel == AABB_SSE) return __builtin_cpu_supports("sse");
+    return true;
+#else
+    return kernel == AABB_SCALAR;
+#endif
+}
+
+inline const char* aabbKernelName(AabbKernel kernel) {
+    return kernel == AABB_AVX2 ? "avx2" : (kernel == AABB_SSE ? "sse" : "scalar");
+}
+
+// The kernel's function; it must be supported
+inline AabbOverlapFn aabbKernel(AabbKernel kernel) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernel == AABB_AVX2) return overlapMaskAvx2;
+    if (kernel == AABB_SSE) return overlapMaskSse;
+#endif
+    return overlapMaskScalar;
+}
+
+// The widest kernel this CPU runs
+inline AabbKernel bestAabbKernel() {
+    if (aabbKernelSupported(AABB_AVX2)) return AABB_AVX2;
+    if (aabbKernelSupported(AABB_SSE)) return AABB_SSE;
+    return AABB_SCALAR;
+}
+
+#endif
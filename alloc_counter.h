@@ -0,0 +1,57 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts every heap allocation made through the global operator new. The
+// replacement operators below may only be defined once per program, so this
+// header belongs in the translation unit that holds main().
+//
+// A hook can be installed to see each allocation as it happens, for finding
+// out what a frame that should not allocate asked for. It runs on the
+// allocating thread, inside operator new, so it must not allocate itself.
+class AllocCounter {
+public:
+    typedef void (*Hook)(std::size_t size);
+
+private:
+    static inline std::atomic<unsigned long long> allocations{0};
+    static inline std::atomic<unsigned long long> bytes{0};
+    static inline std::atomic<Hook> hook{nullptr};
+
+public:
+    static void record(std::size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        Hook current = hook.load(std::memory_order_acquire);
+        if (current) current(size);
+    }
+
+    // Null removes the hook
+    static void setHook(Hook fn) { hook.store(fn, std::memory_order_release); }
+
+    static unsigned long long getAllocations() { return allocations.load(std::memory_order_relaxed); }
+    static unsigned long long getBytes() { return bytes.load(std::memory_order_relaxed); }
+};
+
+void* operator new(std::size_t size) {
+    AllocCounter::record(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+// Kept out of line: once inlined, GCC sees free() paired with operator new
+// and reports a -Wmismatched-new-delete false positive
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
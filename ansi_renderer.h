@@ -0,0 +1,372 @@
+#ifndef ANSI_RENDERER_H
+#define ANSI_RENDERER_H
+
+#include "renderer.h"
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+// Writes frames to the terminal as ANSI escape sequences itself, instead of
+// going through ncurses' update path. Draw code renders into an off-screen
+// copy of the screen; present() diffs the rows drawn on since the last frame
+// against what the terminal shows and encodes only the changed cells:
+//
+// - the cursor gets to each changed run by whichever is shortest of an
+//   absolute move, a relative one, CR/LF, or rewriting the cells in between
+//   when they already have the current attributes
+// - runs of one glyph go out as the glyph plus REP, blank runs to the end of
+//   a row as EL, and without REP, long blank runs as ECH
+// - attributes change only between runs that need different ones
+// - the frame is wrapped in synchronized-update mode (DEC mode 2026) when the
+//   terminal advertises it, and handed to the kernel in a single write()
+//
+// ncurses is still used for the terminal modes, the line-drawing map and the
+// colour pairs, so initscr() (or newterm()) should have run for the glyphs
+// and colours to come out right; without it ACS glyphs are sent as blanks.
+class AnsiRenderer : public Renderer {
+public:
+    struct Features {
+        bool repeat;     // REP (CSI n b) repeats the last glyph
+        bool syncUpdate; // DEC private mode 2026 holds the screen until the frame is complete
+    };
+
+    struct Counters {
+        long long frames;
+        long long cells;  // Cells that differed from the screen
+        long long bytes;
+        long long attrSwitches; // SGR or character set changes sent
+        long long writes; // write() calls, more than one per frame only when the terminal takes partial writes
+    };
+
+private:
+    static const chtype kUnknown = ~chtype(0); // Attribute or cell whose terminal state is not known
+
+    int fd; // Where frames go; -1 only counts the bytes
+    int width, height;
+    Features features;
+    std::vector<chtype> back;  // The frame being drawn
+    std::vector<chtype> front; // What the terminal shows
+    std::vector<int> dirtyFrom, dirtyTo; // Per row: columns drawn on since the last frame, empty when from > to
+    std::vector<char> out;     // Encoded frame, kept allocated between frames
+    int cursorY, cursorX;      // -1 when unknown, as after writing in the last column
+    chtype attr;               // Current SGR state plus A_ALTCHARSET, or kUnknown
+    bool needsClear;
+    Counters frame;
+    Counters total;
+
+    static int digits(int n) {
+        int count = 1;
+        for (; n >= 10; n /= 10) count++;
+        return count;
+    }
+
+    void append(const char* text) {
+        out.insert(out.end(), text, text + strlen(text));
+    }
+
+    void appendNumber(int n) {
+        char text[16];
+        snprintf(text, sizeof(text), "%d", n);
+        append(text);
+    }
+
+    // ESC [ n final, with n left out when it is 1
+    void appendCsi(int n, char final) {
+        append("\x1b[");
+        if (n != 1) appendNumber(n);
+        out.push_back(final);
+    }
+
+    static int csiBytes(int n) { return 3 + (n != 1 ? digits(n) : 0); }
+
+    static bool isPlainBlank(chtype ch) { return (ch & (A_CHARTEXT | A_ATTRIBUTES)) == ' '; }
+
+    static char glyphByte(chtype ch) {
+        chtype c = ch & A_CHARTEXT;
+        return c < 32 || c > 126 ? ' ' : static_cast<char>(c);
+    }
+
+    // Every cell in [from, to) of row y already shows what back holds, with
+    // the current attributes, so the cursor can pass over them by rewriting
+    bool canRewrite(int y, int from, int to) const {
+        for (int x = from; x < to; x++) {
+            int i = y * width + x;
+            if (back[i] != front[i] || (back[i] & A_ATTRIBUTES) != attr) return false;
+        }
+        return true;
+    }
+
+    // Cost of getting along row y from column from to column to
+    int horizontalCost(int y, int from, int to) const {
+        if (from == to) return 0;
+        if (to > from) {
+            int relative = csiBytes(to - from);
+            return to - from < relative && canRewrite(y, from, to) ? to - from : relative;
+        }
+        int left = csiBytes(from - to);
+        int carriage = 1 + horizontalCost(y, 0, to);
+        return std::min(left, carriage);
+    }
+
+    void moveHorizontal(int y, int from, int to) {
+        if (from == to) return;
+        if (to > from) {
+            if (to - from < csiBytes(to - from) && canRewrite(y, from, to)) {
+                for (int x = from; x < to; x++) out.push_back(glyphByte(back[y * width + x]));
+            } else {
+                appendCsi(to - from, 'C');
+            }
+        } else if (csiBytes(from - to) <= 1 + horizontalCost(y, 0, to)) {
+            appendCsi(from - to, 'D');
+        } else {
+            out.push_back('\r');
+            moveHorizontal(y, 0, to);
+        }
+    }
+
+    void moveTo(int y, int x) {
+        if (cursorY == y && cursorX == x) return;
+
+        int absolute = 4 + digits(y + 1) + digits(x + 1);
+        int best = absolute;
+        int plan = 0; // 0 absolute, 1 along the row, 2 up or down then along, 3 CR then LFs then along
+        if (cursorY == y) {
+            int cost = horizontalCost(y, cursorX, x);
+            if (cost < best) { best = cost; plan = 1; }
+        } else if (cursorY >= 0) {
+            int cost = csiBytes(std::abs(y - cursorY)) + horizontalCost(y, cursorX, x);
+            if (cost < best) { best = cost; plan = 2; }
+            // LF keeps or resets the column depending on the tty's output
+            // flags, so it is only used after a CR
+            if (y > cursorY) {
+                cost = 1 + (y - cursorY) + horizontalCost(y, 0, x);
+                if (cost < best) { best = cost; plan = 3; }
+            }
+        }
+
+        switch (plan) {
+            case 0:
+                append("\x1b[");
+                appendNumber(y + 1);
+                out.push_back(';');
+                appendNumber(x + 1);
+                out.push_back('H');
+                break;
+            case 1:
+                moveHorizontal(y, cursorX, x);
+                break;
+            case 2:
+                appendCsi(std::abs(y - cursorY), y > cursorY ? 'B' : 'A');
+                moveHorizontal(y, cursorX, x);
+                break;
+            case 3:
+                out.push_back('\r');
+                out.insert(out.end(), y - cursorY, '\n');
+                moveHorizontal(y, 0, x);
+                break;
+        }
+        cursorY = y;
+        cursorX = x;
+    }
+
+    // SGR from a reset, then the line-drawing set switched in or out
+    void setAttr(chtype wanted) {
+        if (wanted == attr) return;
+        frame.attrSwitches++;
+        chtype style = A_ATTRIBUTES & ~A_ALTCHARSET;
+        if (attr == kUnknown || (wanted & style) != (attr & style)) {
+            append("\x1b[0");
+            if (wanted & A_BOLD) append(";1");
+            if (wanted & A_DIM) append(";2");
+            if (wanted & A_UNDERLINE) append(";4");
+            if (wanted & A_BLINK) append(";5");
+            if (wanted & A_REVERSE) append(";7");
+            short pair = static_cast<short>(PAIR_NUMBER(wanted));
+            short fg = -1, bg = -1;
+            if (pair != 0 && pair_content(pair, &fg, &bg) == ERR) {
+                fg = pair % 8; // No colour table to look in: any colour costs the same
+                bg = 0;
+            }
+            if (fg >= 0 && fg < 8) {
+                append(";3");
+                appendNumber(fg);
+            }
+            if (bg >= 0 && bg < 8) {
+                append(";4");
+                appendNumber(bg);
+            }
+            out.push_back('m');
+        }
+        if (attr == kUnknown || ((wanted ^ attr) & A_ALTCHARSET)) {
+            append(wanted & A_ALTCHARSET ? "\x1b(0" : "\x1b(B");
+        }
+        attr = wanted;
+    }
+
+    // Encodes the changes in columns [from, to] of row y, leaving front
+    // matching back there
+    void encodeRow(int y, int from, int to) {
+        chtype* want = &back[y * width];
+        chtype* have = &front[y * width];
+        int x = from;
+        while (x <= to) {
+            if (want[x] == have[x]) {
+                x++;
+                continue;
+            }
+
+            // The run of this glyph from x, up to its last cell that changed
+            chtype ch = want[x];
+            int end = x + 1;
+            for (int i = x + 1; i < width && want[i] == ch; i++) {
+                if (have[i] != ch) end = i + 1;
+            }
+            int run = end - x;
+            for (int i = x; i < end; i++) {
+                if (have[i] != want[i]) frame.cells++;
+                have[i] = want[i];
+            }
+
+            moveTo(y, x);
+
+            // Blanks to the end of the row: one erase covers them all
+            if (isPlainBlank(ch)) {
+                int last = x;
+                while (last < width && isPlainBlank(want[last])) last++;
+                if (last == width) {
+                    setAttr(A_NORMAL);
+                    append("\x1b[K");
+                    for (int i = end; i < width; i++) {
+                        if (have[i] != want[i]) frame.cells++;
+                        have[i] = want[i];
+                    }
+                    break;
+                }
+                if (!features.repeat && run > csiBytes(run) + 4) {
+                    setAttr(A_NORMAL);
+                    appendCsi(run, 'X'); // Erases in place, so the cursor has not moved
+                    x = end;
+                    continue;
+                }
+            }
+
+            setAttr(ch & A_ATTRIBUTES);
+            char glyph = glyphByte(ch);
+            out.push_back(glyph);
+            if (run > 1 && features.repeat && csiBytes(run - 1) < run - 1) {
+                appendCsi(run - 1, 'b');
+            } else {
+                out.insert(out.end(), run - 1, glyph);
+            }
+
+            // The last column leaves the cursor waiting to wrap
+            cursorX = end < width ? end : -1;
+            if (cursorX < 0) cursorY = -1;
+            x = end;
+        }
+    }
+
+    void send() {
+        frame.bytes = static_cast<long long>(out.size());
+        if (fd < 0) return;
+        size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t n = write(fd, out.data() + sent, out.size() - sent);
+            frame.writes++;
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+public:
+    // What the terminal ncurses was set up on can do, from its terminfo entry;
+    // nothing before ncurses is set up. Sync is an extended capability, in the
+    // entries of terminals that implement mode 2026.
+    static Features detectFeatures() {
+        Features detected = {false, false};
+        char* rep = tigetstr("rep");
+        char* sync = tigetstr("Sync");
+        detected.repeat = rep != nullptr && rep != reinterpret_cast<char*>(-1);
+        detected.syncUpdate = sync != nullptr && sync != reinterpret_cast<char*>(-1);
+        return detected;
+    }
+
+    // Covers a w by h screen written to fd, which the first frame clears
+    AnsiRenderer(int fd, int w, int h, Features features)
+        : fd(fd), width(w), height(h), features(features), back(static_cast<size_t>(w) * h, ' '),
+          front(back), dirtyFrom(h, 0), dirtyTo(h, w - 1), cursorY(-1), cursorX(-1), attr(kUnknown), needsClear(true), frame(), total() {
+        out.reserve(static_cast<size_t>(w) * h * 2);
+    }
+
+    void putChar(int y, int x, chtype ch) override {
+        if (x < 0 || y < 0 || x >= width || y >= height) return;
+        back[y * width + x] = ch;
+        dirtyFrom[y] = std::min(dirtyFrom[y], x);
+        dirtyTo[y] = std::max(dirtyTo[y], x);
+    }
+
+    void putText(int y, int x, chtype attrs, const char* text) override {
+        for (; *text != '\0'; text++, x++) {
+            putChar(y, x, static_cast<unsigned char>(*text) | attrs);
+        }
+    }
+
+    void clearToEol(int y, int x) override {
+        for (; x < width; x++) {
+            putChar(y, x, ' ');
+        }
+    }
+
+    void present() override {
+        out.clear();
+        frame = Counters();
+        frame.frames = 1;
+
+        if (features.syncUpdate) append("\x1b[?2026h");
+        bool cleared = needsClear;
+        if (needsClear) {
+            setAttr(A_NORMAL);
+            append("\x1b[H\x1b[2J");
+            std::fill(front.begin(), front.end(), chtype(' '));
+            cursorY = cursorX = 0;
+            needsClear = false;
+        }
+        for (int y = 0; y < height; y++) {
+            if (dirtyFrom[y] > dirtyTo[y]) continue;
+            encodeRow(y, dirtyFrom[y], dirtyTo[y]);
+            dirtyFrom[y] = width;
+            dirtyTo[y] = -1;
+        }
+        if (features.syncUpdate) append("\x1b[?2026l");
+
+        // Nothing changed: not even the mode switches go out
+        if (frame.cells == 0 && !cleared) out.clear();
+        send();
+
+        total.frames += frame.frames;
+        total.cells += frame.cells;
+        total.bytes += frame.bytes;
+        total.attrSwitches += frame.attrSwitches;
+        total.writes += frame.writes;
+    }
+
+    // Makes the next frame clear the terminal and send every cell, for when
+    // something else has drawn on it
+    void invalidate() {
+        needsClear = true;
+        std::fill(dirtyFrom.begin(), dirtyFrom.end(), 0);
+        std::fill(dirtyTo.begin(), dirtyTo.end(), width - 1);
+    }
+
+    int getWidth() const override { return width; }
+    int getHeight() const override { return height; }
+
+    const Counters& getFrameCounters() const { return frame; }
+    const Counters& getTotalCounters() const { return total; }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "alloc_counter.h"
+
+// Per-frame timing for the --bench modes. Each measured call is timed on its
+// own so the report can show latency percentiles and not just the mean, and
+// allocations made inside the call are counted alongside, with their bytes.
+class FrameStats {
+private:
+    std::vector<double> samples; // ns per frame
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+
+public:
+    explicit FrameStats(int frames) : allocations(0), allocatedBytes(0) {
+        samples.reserve(frames);
+    }
+
+    template <typename Fn>
+    void measure(Fn frame) {
+        unsigned long long allocsBefore = AllocCounter::getAllocations();
+        unsigned long long bytesBefore = AllocCounter::getBytes();
+        auto start = std::chrono::steady_clock::now();
+        frame();
+        auto end = std::chrono::steady_clock::now();
+        allocations += AllocCounter::getAllocations() - allocsBefore;
+        allocatedBytes += AllocCounter::getBytes() - bytesBefore;
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    // One report row; sorts the samples, so call it once measuring is done
+    void print(const char* name, int scale, long long entities) {
+        if (samples.empty()) return;
+        std::sort(samples.begin(), samples.end());
+
+        double total = 0;
+        for (double ns : samples) total += ns;
+        size_t n = samples.size();
+
+        printf("%-18s %6dx %9lld %12.0f %12.0f %12.0f %10.3f %10.1f\n", name, scale, entities, total / n,
+               samples[n / 2], samples[std::min(n - 1, n * 99 / 100)], static_cast<double>(allocations) / n,
+               static_cast<double>(allocatedBytes) / n);
+    }
+
+    static void printHeader() {
+        printf("%-18s %7s %9s %12s %12s %12s %10s %10s\n", "benchmark", "scale", "entities", "ns/frame", "p50 ns",
+               "p99 ns", "allocs/fr", "bytes/fr");
+    }
+};
+
+// Latency distribution in power-of-two microsecond buckets: bucket 0 holds
+// samples under 1 us, bucket i those from 2^(i-1) up to 2^i us. Fixed size, so
+// recording a sample never allocates.
+class LatencyHistogram {
+private:
+    static const int kBuckets = 24; // The last bucket takes everything from ~4 s up
+    unsigned long long counts[kBuckets];
+    unsigned long long samples;
+    double totalNs, maxNs;
+
+    static int bucketFor(double ns) {
+        int bucket = 0;
+        for (double limit = 1000.0; ns >= limit && bucket < kBuckets - 1; limit *= 2) bucket++;
+        return bucket;
+    }
+
+    // Upper edge of the bucket holding the given fraction of samples, in us
+    double percentileUs(double fraction) const {
+        unsigned long long target = static_cast<unsigned long long>(fraction * samples);
+        unsigned long long seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += counts[i];
+            if (seen > target) return static_cast<double>(1ULL << i);
+        }
+        return maxNs / 1000.0;
+    }
+
+public:
+    LatencyHistogram() : counts(), samples(0), totalNs(0), maxNs(0) {}
+
+    void add(std::chrono::steady_clock::duration latency) {
+        double ns = std::chrono::duration<double, std::nano>(latency).count();
+        counts[bucketFor(ns)]++;
+        samples++;
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    unsigned long long getSamples() const { return samples; }
+
+    void print(FILE* out, const char* name) const {
+        if (samples == 0) {
+            fprintf(out, "%s: no samples\n", name);
+            return;
+        }
+        fprintf(out, "%s: %llu samples  mean %.0f us  p50 < %.0f us  p99 < %.0f us  max %.0f us\n", name, samples,
+                totalNs / samples / 1000.0, percentileUs(0.5), percentileUs(0.99), maxNs / 1000.0);
+        for (int i = 0; i < kBuckets; i++) {
+            if (counts[i] == 0) continue;
+            fprintf(out, "  < %8llu us %8llu\n", 1ULL << i, counts[i]);
+        }
+    }
+};
+
+// Steady-state check for the --alloc-check modes: once a game is warmed up,
+// no frame may allocate. Frames are run through measure(); the first one that
+// allocates is remembered along with the sizes it asked for, which usually
+// points straight at the container that grew.
+class AllocCheck {
+private:
+    static const int kMaxSizes = 8;
+    static inline std::atomic<int> sizeCount{0};
+    static inline std::size_t sizes[kMaxSizes];
+
+    long long frames;
+    long long failedFrames;
+    long long firstFailure;         // Frame number, -1 while every frame has passed
+    std::size_t firstSizes[kMaxSizes];
+    int firstSizeCount;
+    unsigned long long allocations; // Over every failed frame
+    unsigned long long bytes;
+
+    static void recordSize(std::size_t size) {
+        int i = sizeCount.fetch_add(1, std::memory_order_relaxed);
+        if (i < kMaxSizes) sizes[i] = size;
+    }
+
+public:
+    AllocCheck()
+        : frames(0), failedFrames(0), firstFailure(-1), firstSizes(), firstSizeCount(0), allocations(0), bytes(0) {}
+
+    // Runs one frame; returns false when it allocated
+    template <typename Fn>
+    bool measure(Fn frame) {
+        unsigned long long allocsBefore = AllocCounter::getAllocations();
+        unsigned long long bytesBefore = AllocCounter::getBytes();
+        sizeCount.store(0, std::memory_order_relaxed);
+        AllocCounter::setHook(recordSize);
+        frame();
+        AllocCounter::setHook(nullptr);
+        unsigned long long allocated = AllocCounter::getAllocations() - allocsBefore;
+
+        frames++;
+        if (allocated == 0) return true;
+        failedFrames++;
+        allocations += allocated;
+        bytes += AllocCounter::getBytes() - bytesBefore;
+        if (firstFailure < 0) {
+            firstFailure = frames - 1;
+            firstSizeCount = std::min(sizeCount.load(std::memory_order_relaxed), kMaxSizes);
+            std::copy(sizes, sizes + firstSizeCount, firstSizes);
+        }
+        return false;
+    }
+
+    long long getFrames() const { return frames; }
+    bool passed() const { return failedFrames == 0; }
+
+    // One line, or two on failure; returns the exit code for the check
+    int report(FILE* out, const char* name) const {
+        if (passed()) {
+            fprintf(out, "%s: %lld frames, none allocated\n", name, frames);
+            return 0;
+        }
+        fprintf(out, "%s: FAILED, %lld of %lld frames allocated (%llu allocations, %llu bytes)\n", name,
+                failedFrames, frames, allocations, bytes);
+        fprintf(out, "  first at frame %lld, sizes:", firstFailure);
+        for (int i = 0; i < firstSizeCount; i++) fprintf(out, " %zu", firstSizes[i]);
+        fprintf(out, "\n");
+        return 1;
+    }
+};
+
+// Entity multipliers every benchmark is run at
+const int kBenchScales[] = {1, 10, 100, 1000};
+
+#endif
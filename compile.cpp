@@ -3,6 +3,17 @@
 #include <cmath>
 #include <cstring>
 #include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include "spatial_grid.h"
+#include "renderer.h"
+#include "static_layer.h"
+#include "ansi_renderer.h"
+#include "frame_clock.h"
+#include "bench.h"
+#include "input_log.h"
+#include "sweep.h"
 
 // Forward declarations
 class Ball;
@@ -62,21 +73,21 @@ public:
         y = newY;
     }
 
-    void clearPrevious() {
-        // Clear the previous position
+    void clearPrevious(Renderer& out, const StaticLayer& background) {
+        // Put back whatever the paddle was covering
         for (int i = 0; i < width; i++) {
-            mvaddch(lastDrawnY, lastDrawnX + i, ' ');
+            background.restore(out, lastDrawnY, lastDrawnX + i);
         }
     }
 
-    void draw() {
+    void draw(Renderer& out, const StaticLayer& background) {
         int currentX = static_cast<int>(round(x));
         int currentY = static_cast<int>(round(y));
         
         // Only redraw if position has changed
         if (currentX != lastDrawnX || currentY != lastDrawnY) {
             // Clear previous position if it's different
-            clearPrevious();
+            clearPrevious(out, background);
             
             // Update last drawn position
             lastDrawnX = currentX;
@@ -84,11 +95,9 @@ public:
         }
         
         // Draw paddle (a line of characters)
-        attron(COLOR_PAIR(1)); // Paddle color
         for (int i = 0; i < width; i++) {
-            mvaddch(currentY, currentX + i, '=');
+            out.putChar(currentY, currentX + i, '=' | COLOR_PAIR(1)); // Paddle color
         }
-        attroff(COLOR_PAIR(1));
     }
 
     float getX() const { return x; }
@@ -115,10 +124,15 @@ public:
         speed(0.2f), active(true) {}
 
     void update() {
+        advance(1.0f);
+    }
+
+    // Moves the given fraction of one update's travel
+    void advance(float fraction) {
         if (active) {
             // Move in the current direction scaled by deltaTime for smooth movement
-            x += directionX * speed;
-            y += directionY * speed;
+            x += directionX * speed * fraction;
+            y += directionY * speed * fraction;
         }
     }
 
@@ -160,19 +174,19 @@ public:
         y = newY;
     }
 
-    void clearPrevious() {
-        // Clear the previous position
-        mvaddch(lastDrawnY, lastDrawnX, ' ');
+    void clearPrevious(Renderer& out, const StaticLayer& background) {
+        // Put back whatever the ball was covering
+        background.restore(out, lastDrawnY, lastDrawnX);
     }
 
-    void draw() {
+    void draw(Renderer& out, const StaticLayer& background) {
         int currentX = static_cast<int>(round(x));
         int currentY = static_cast<int>(round(y));
         
         // Only redraw if position has changed
         if (currentX != lastDrawnX || currentY != lastDrawnY) {
             // Clear previous position if it's different
-            clearPrevious();
+            clearPrevious(out, background);
             
             // Update last drawn position
             lastDrawnX = currentX;
@@ -180,9 +194,7 @@ public:
         }
         
         // Draw ball
-        attron(COLOR_PAIR(2)); // Ball color
-        mvaddch(currentY, currentX, 'O');
-        attroff(COLOR_PAIR(2));
+        out.putChar(currentY, currentX, 'O' | COLOR_PAIR(2)); // Ball color
     }
 
     float getX() const { return x; }
@@ -198,46 +210,48 @@ private:
     int x, y;             // Position
     int width, height;    // Size
     bool active;          // Whether the block is active (not destroyed)
+    bool needsRedraw;     // Added or destroyed since the last draw
     int colorPair;        // Color pair to use for the block
 
 public:
     Block(int startX, int startY, int w = 5, int h = 1, int color = 3) 
-        : x(startX), y(startY), width(w), height(h), active(true), colorPair(color) {}
+        : x(startX), y(startY), width(w), height(h), active(true), needsRedraw(true), colorPair(color) {}
 
-    void draw() {
-        if (!active) return;
+    // Draws the block once when it appears and erases it once when it is
+    // destroyed; in between its cells are left alone
+    void draw(Renderer& out) {
+        if (!needsRedraw) return;
+        needsRedraw = false;
+        if (!active) {
+            clear(out);
+            return;
+        }
 
-        attron(COLOR_PAIR(colorPair));
         for (int row = 0; row < height; ++row) {
             for (int col = 0; col < width; ++col) {
-                mvaddch(y + row, x + col, ACS_CKBOARD);
+                out.putChar(y + row, x + col, ACS_CKBOARD | COLOR_PAIR(colorPair));
             }
         }
-        attroff(COLOR_PAIR(colorPair));
     }
 
-    void clear() {
+    void clear(Renderer& out) {
         for (int row = 0; row < height; ++row) {
             for (int col = 0; col < width; ++col) {
-                mvaddch(y + row, x + col, ' ');
+                out.putChar(y + row, x + col, ' ');
             }
         }
     }
 
-    bool collidesWith(const Ball& ball) const {
+    // Sweeps the ball's point along a move of (moveX, moveY) against the block
+    bool sweep(const Ball& ball, float moveX, float moveY, float maxTime, SweepHit& hit) const {
         if (!active) return false;
-
-        float ballX = ball.getX();
-        float ballY = ball.getY();
-
-        // Simple bounding box collision
-        return (ballX >= x && ballX < x + width &&
-                ballY >= y && ballY < y + height);
+        return sweepBox(ball.getX(), ball.getY(), moveX, moveY, x, y, x + width, y + height, maxTime, hit);
     }
-
+    
     void setActive(bool isActive) {
         if (active && !isActive) {
-            clear();
+            // If being deactivated, clear from screen on the next draw
+            needsRedraw = true;
         }
         active = isActive;
     }
@@ -263,28 +277,25 @@ public:
     BattleBox(int startX, int startY, int w, int h) :
         x(startX), y(startY), width(w), height(h), needsRedraw(true) {}
 
-    void draw() {
+    void draw(Renderer& out) {
         if (!needsRedraw) return;
         
-        // Enable reverse highlighting
-        attron(A_REVERSE);
+        // Borders are reverse-highlighted spaces
+        chtype border = ' ' | A_REVERSE;
     
         // Draw the top and bottom borders of the battle box
         for (int i = -1; i <= width+1; i++) {
-            mvaddch(y, x + i, ' ');              // Top border (space with reverse highlight)
-            mvaddch(y + height, x + i, ' ');     // Bottom border
+            out.putChar(y, x + i, border);              // Top border (space with reverse highlight)
+            out.putChar(y + height, x + i, border);     // Bottom border
         }
     
         // Draw the left and right borders of the battle box
         for (int i = 0; i <= height; i++) {
-            mvaddch(y + i, x, ' ');              // Left border
-            mvaddch(y + i, x + width, ' ');      // Right border
-            mvaddch(y + i, x-1, ' ');            // Left border
-            mvaddch(y + i, x+1 + width, ' ');    // Right border
+            out.putChar(y + i, x, border);              // Left border
+            out.putChar(y + i, x + width, border);      // Right border
+            out.putChar(y + i, x-1, border);            // Left border
+            out.putChar(y + i, x+1 + width, border);    // Right border
         }
-    
-        // Disable reverse highlighting
-        attroff(A_REVERSE);
         
         needsRedraw = false;
     }
@@ -303,21 +314,32 @@ public:
 class GameManager {
 private:
     BattleBox battleBox;
+    StaticLayer background; // Border and blocks, flushed to the screen only where they change
     Paddle paddle;
     Ball ball;
     std::vector<Block> blocks;
+    std::vector<int> changedBlocks; // Blocks added or destroyed since the last draw()
+    SpatialGrid blockGrid; // Active blocks by grid cell, rebuilt by initializeBlocks()
     int blockCount;
+    int blockRows;        // Rows of blocks laid out by initializeBlocks()
+    int screenWidth, screenHeight;
     bool gameOver;
     bool gameWon;
+
+    static const int kMaxBounces = 8; // Contacts resolved in one update before the rest of the move is dropped
     
 public:
-    GameManager(int screenWidth, int screenHeight) : 
-        battleBox(screenWidth / 2 - 20, screenHeight / 2 - 8, 40, 16),
+    GameManager(int screenWidth, int screenHeight, int boxWidth = 40, int boxHeight = 16, int rows = 5) : 
+        battleBox(screenWidth / 2 - boxWidth / 2, screenHeight / 2 - boxHeight / 2, boxWidth, boxHeight),
+        background(battleBox.getX() - 1, battleBox.getY(), boxWidth + 3, boxHeight + 1),
         paddle(battleBox.getX() + (battleBox.getWidth() - 7) / 2, 
                battleBox.getY() + battleBox.getHeight() - 1), // Paddle just above the bottom of the box
         ball(battleBox.getX() + (battleBox.getWidth() / 2), 
              battleBox.getY() + (battleBox.getHeight() - 3)), // Ball above the paddle
         blockCount(0),
+        blockRows(rows),
+        screenWidth(screenWidth),
+        screenHeight(screenHeight),
         gameOver(false),
         gameWon(false) {
         
@@ -328,6 +350,7 @@ public:
     void initializeBlocks() {
         // Clear existing blocks
         blocks.clear();
+        changedBlocks.clear();
         blockCount = 0;
         
         // Calculate the number of blocks that fit in the battle box
@@ -340,7 +363,11 @@ public:
         int boxY = battleBox.getY() + 2; // Starting a bit down from the top
         
         int blocksPerRow = (boxWidth + padding) / (blockWidth + padding);
-        int maxRows = 5; // Number of rows of blocks
+        int maxRows = blockRows; // Number of rows of blocks
+
+        // One grid cell per block slot
+        blockGrid.resize(battleBox.getX(), battleBox.getY(), battleBox.getWidth(), battleBox.getHeight(),
+                         blockWidth + padding, blockHeight + padding);
 
         // Calculate total width of all blocks in a row, including padding
         int totalBlockWidth = blocksPerRow * blockWidth + (blocksPerRow - 1) * padding;
@@ -356,6 +383,8 @@ public:
                 // Use different colors for different rows
                 int blockColor = 3 + (row % 5);
                 
+                blockGrid.insert(static_cast<int>(blocks.size()), blockX, blockY, blockWidth, blockHeight);
+                changedBlocks.push_back(static_cast<int>(blocks.size()));
                 blocks.push_back(Block(blockX, blockY, blockWidth, blockHeight, blockColor));
                 blockCount++;
             }
@@ -378,107 +407,139 @@ public:
             paddle.setPosition(static_cast<float>(battleBox.getX() + battleBox.getWidth() - paddle.getWidth()), paddleY);
         }
         
-        // Update ball position
-        ball.update(); 
-        
-        // Ball collision with walls
-        float ballX = ball.getX();
-        float ballY = ball.getY();
-        
-        // Left and right walls
-        if (ballX <= battleBox.getX() + 1 || ballX >= battleBox.getX() + battleBox.getWidth() - 1) {
-            ball.reverseX();
-        }
-        
-        // Top wall
-        if (ballY <= battleBox.getY() + 1) {
-            ball.reverseY();
-        }
-        
-        // Bottom edge - game over
-        if (ballY >= battleBox.getY() + battleBox.getHeight() - 1) {
-            gameOver = true;
-            return;
-        }
-        
-        // Ball collision with paddle
-        if (ballY > paddleY - 1 && ballY < paddleY &&
-            ballX >= paddleX && ballX < paddleX + paddle.getWidth()-1) {
-            
-            // Ball hit paddle - bounce upward
-            ball.reverseY();
-            
-            // Change ball's horizontal direction based on where it hit the paddle
-            // This gives more control to the player
-            float hitPosition = (ballX - paddleX) / paddle.getWidth(); // 0.0 to 1.0
-            float newDirX = 2.0f * (hitPosition - 0.4f); // -1.0 to 1.0
-            newDirX = std::max(-0.8f, std::min(0.8f, newDirX));
-            
-            // Set new direction, keeping the y-direction the same but reversing it
-            float dirY = -abs(ball.getDirectionY()); // Ensure ball goes upward
-            dirY = std::min(0.01f, newDirX);
-            ball.setDirection(newDirX, dirY);
-        }
-        
-        // Ball collision with blocks
-        for (auto& block : blocks) {
-            if (block.isActive() && block.collidesWith(ball)) {
+        paddleX = paddle.getX(); // After clamping
+
+        // Ball movement is swept: find the first surface the ball would touch on
+        // its way, stop it there, bounce, and carry on with what is left of the
+        // move. However far the ball goes in one update it cannot skip anything.
+        float moveLeft = 1.0f; // Fraction of this update's travel still to go
+        for (int bounce = 0; bounce < kMaxBounces && moveLeft > 0 && ball.isActive(); bounce++) {
+            float ballX = ball.getX();
+            float ballY = ball.getY();
+            float moveX = ball.getDirectionX() * ball.getSpeed() * moveLeft;
+            float moveY = ball.getDirectionY() * ball.getSpeed() * moveLeft;
+
+            enum { HIT_NONE, HIT_WALL, HIT_FLOOR, HIT_PADDLE, HIT_BLOCK } target = HIT_NONE;
+            SweepHit hit = {1.0f, false};
+            SweepHit candidate;
+
+            // Walls; the bottom edge ends the game instead of bouncing
+            float timeX = sweepBounds(ballX, moveX, battleBox.getX() + 1, battleBox.getX() + battleBox.getWidth() - 1);
+            float timeY = sweepBounds(ballY, moveY, battleBox.getY() + 1, battleBox.getY() + battleBox.getHeight() - 1);
+            if (timeX < hit.time) {
+                hit = {timeX, true};
+                target = HIT_WALL;
+            }
+            if (timeY < hit.time) {
+                hit = {timeY, false};
+                target = moveY > 0 ? HIT_FLOOR : HIT_WALL;
+            }
+
+            // Paddle, only on the way down
+            if (moveY > 0 && sweepBox(ballX, ballY, moveX, moveY, paddleX, paddleY - 1,
+                                      paddleX + paddle.getWidth() - 1, paddleY, hit.time, candidate)) {
+                hit = candidate;
+                target = HIT_PADDLE;
+            }
+
+            // Only blocks in the grid cells the move passes over are candidates. The
+            // lowest index wins a tie so the cell order does not matter.
+            int hitIndex = -1;
+            blockGrid.query(std::min(ballX, ballX + moveX), std::min(ballY, ballY + moveY),
+                            std::abs(moveX), std::abs(moveY), [&](int id) {
+                if (!blocks[id].sweep(ball, moveX, moveY, 1.0f, candidate)) return;
+                if (candidate.time < hit.time || (target == HIT_BLOCK && candidate.time == hit.time && id < hitIndex)) {
+                    hit = candidate;
+                    target = HIT_BLOCK;
+                    hitIndex = id;
+                }
+            });
+
+            ball.advance(moveLeft * hit.time);
+            moveLeft -= moveLeft * hit.time;
+
+            if (target == HIT_NONE) break;
+
+            // Bottom edge - game over
+            if (target == HIT_FLOOR) {
+                gameOver = true;
+                return;
+            }
+
+            if (target == HIT_WALL) {
+                if (hit.reflectX) {
+                    ball.reverseX();
+                } else {
+                    ball.reverseY();
+                }
+            } else if (target == HIT_PADDLE && hit.reflectX) {
+                ball.reverseX(); // Clipped the end of the paddle
+            } else if (target == HIT_PADDLE) {
+                // Ball hit paddle - bounce upward
+                ball.reverseY();
+
+                // Change ball's horizontal direction based on where it hit the paddle
+                // This gives more control to the player
+                float hitPosition = (ball.getX() - paddleX) / paddle.getWidth(); // 0.0 to 1.0
+                float newDirX = 2.0f * (hitPosition - 0.4f); // -1.0 to 1.0
+                newDirX = std::max(-0.8f, std::min(0.8f, newDirX));
+
+                // Set new direction, keeping the y-direction the same but reversing it
+                float dirY = -abs(ball.getDirectionY()); // Ensure ball goes upward
+                dirY = std::min(-0.01f, dirY);
+                ball.setDirection(newDirX, dirY);
+            } else {
+                Block& block = blocks[hitIndex];
                 // Block hit - deactivate it
                 block.setActive(false);
+                changedBlocks.push_back(hitIndex);
+                blockGrid.remove(hitIndex, block.getX(), block.getY(), block.getWidth(), block.getHeight());
                 blockCount--;
-                
-                // Bounce the ball
-                // Determine if the ball hit the side or top/bottom of the block
-                float ballDirX = ball.getDirectionX();
-                float ballDirY = ball.getDirectionY();
-                
-                // Simple approach: reverse direction based on ball's movement direction
-                if (abs(ballDirX) > abs(ballDirY)) {
-                    ball.reverseX(); // Likely hit the side
+
+                // Bounce off the face the ball came in through
+                if (hit.reflectX) {
+                    ball.reverseX();
                 } else {
-                    ball.reverseY(); // Likely hit the top/bottom
+                    ball.reverseY();
                 }
-                
-                // Check if all blocks are destroyed (win condition)
-                if (blockCount <= 0) {
-                    gameWon = true;
-                }
-                
-                // Only handle one collision per update
-                break;
             }
         }
+
+        // Check if all blocks are destroyed (win condition)
+        if (blockCount <= 0) {
+            gameWon = true;
+        }
     }
     
-    void draw() {
-        battleBox.draw();
-        
-        // Draw blocks
-        for (auto& block : blocks) {
-            block.draw();
+    void draw(Renderer& out) {
+        // Border and blocks only draw what changed into the layer, which then
+        // copies those cells to the screen
+        battleBox.draw(background);
+        for (int index : changedBlocks) {
+            blocks[index].draw(background);
         }
+        changedBlocks.clear();
+        background.flush(out);
         
-        // Draw paddle and ball
-        paddle.draw();
-        ball.draw();
+        // Draw paddle and ball over it
+        paddle.draw(out, background);
+        ball.draw(out, background);
         
         // Draw game state messages
-        int maxY, maxX;
-        getmaxyx(stdscr, maxY, maxX);
+        int maxY = out.getHeight();
+        int maxX = out.getWidth();
         
-        mvprintw(maxY - 3, 2, "Left/Right arrows to move paddle    Blocks remaining: %d", blockCount);
-        mvprintw(maxY - 2, 2, "Space to stop/restart    Q to quit");
+        out.print(maxY - 3, 2, "Left/Right arrows to move paddle    Blocks remaining: %d", blockCount);
+        out.print(maxY - 2, 2, "Space to stop/restart    Q to quit");
         
         if (gameOver) {
-            attron(COLOR_PAIR(1)); // Red for game over
-            mvprintw(maxY / 2, maxX / 2 - 5, "GAME OVER");
-            mvprintw(maxY / 2 + 1, maxX / 2 - 11, "Press ENTER to restart");
-            attroff(COLOR_PAIR(1));
+            // Red for game over
+            out.printAttr(maxY / 2, maxX / 2 - 5, COLOR_PAIR(1), "GAME OVER");
+            out.printAttr(maxY / 2 + 1, maxX / 2 - 11, COLOR_PAIR(1), "Press ENTER to restart");
         } else if (gameWon) {
-            attron(COLOR_PAIR(3)); // Green for win
-            mvprintw(maxY / 2, maxX / 2 - 9, "YOU WIN! ALL BLOCKS CLEARED");
-            mvprintw(maxY / 2 + 1, maxX / 2 - 11, "Press ENTER to restart");
-            attroff(COLOR_PAIR(3));
+            // Green for win
+            out.printAttr(maxY / 2, maxX / 2 - 9, COLOR_PAIR(3), "YOU WIN! ALL BLOCKS CLEARED");
+            out.printAttr(maxY / 2 + 1, maxX / 2 - 11, COLOR_PAIR(3), "Press ENTER to restart");
         }
     }
     
@@ -530,18 +591,23 @@ public:
     bool isGameWon() const {
         return gameWon;
     }
+
+    int getBlocksRemaining() const { return blockCount; }
+    const Ball& getBall() const { return ball; }
+    const Paddle& getPaddle() const { return paddle; }
+
+    // Fingerprint of the simulation state, for checking that replays match
+    uint64_t stateHash() const {
+        float state[] = {ball.getX(), ball.getY(), ball.getDirectionX(), ball.getDirectionY(), paddle.getX()};
+        uint64_t h = hashBytes(state, sizeof(state));
+        h = hashBytes(&blockCount, sizeof(blockCount), h);
+        h = hashBytes(&gameOver, sizeof(gameOver), h);
+        return hashBytes(&gameWon, sizeof(gameWon), h);
+    }
 };
 
-int main() {
-    // Initialize ncurses
-    initscr();
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
-    curs_set(0);  // Hide cursor
-    nodelay(stdscr, TRUE);  // Non-blocking input
-    
-    // Set up colors if terminal supports them
+// Sets up the colour pairs the draw code uses, if the terminal has colours
+void initColors() {
     if (has_colors()) {
         start_color();
         init_pair(1, COLOR_RED, COLOR_BLACK);    // Paddle color
@@ -552,43 +618,281 @@ int main() {
         init_pair(6, COLOR_BLUE, COLOR_BLACK);   // Block color 4
         init_pair(7, COLOR_WHITE, COLOR_BLACK);  // Block color 5
     }
+}
+
+// Steers the paddle toward the ball, used by --bench
+int autopilotKey(const GameManager& game) {
+    float paddleCenter = game.getPaddle().getX() + game.getPaddle().getWidth() / 2.0f;
+    return game.getBall().getX() < paddleCenter ? KEY_LEFT : KEY_RIGHT;
+}
+
+// Benchmark mode: times update and draw at scaled block counts. Scale k widens
+// the battle box and adds rows until there are about k times the usual blocks.
+int runBenchmark(int frames) {
+    FrameStats::printHeader();
+
+    GameManager probe(40 + 10, 16 + 10, 40, 16, 1);
+    int baseBlocks = probe.getBlocksRemaining() * 5;
+
+    for (int scale : kBenchScales) {
+        int boxWidth = static_cast<int>(40 * std::sqrt(static_cast<float>(scale)));
+        GameManager rowProbe(boxWidth + 10, 16 + 10, boxWidth, 16, 1);
+        int perRow = rowProbe.getBlocksRemaining();
+        int rows = (baseBlocks * scale + perRow - 1) / perRow;
+        // Tall enough that the paddle and ball start below the blocks
+        int boxHeight = std::max(static_cast<int>(16 * std::sqrt(static_cast<float>(scale))), rows * 2 + 8);
+        int screenWidth = boxWidth + 10;
+        int screenHeight = boxHeight + 10;
+        long long blockCount = static_cast<long long>(rows) * perRow;
+
+        // Games that end are replaced outside the timed region
+        std::unique_ptr<GameManager> game;
+        auto nextGame = [&]() {
+            if (!game || game->isGameOver() || game->isGameWon()) {
+                game.reset(new GameManager(screenWidth, screenHeight, boxWidth, boxHeight, rows));
+            }
+        };
+
+        FrameStats updateStats(frames);
+        for (int f = 0; f < frames; f++) {
+            nextGame();
+            int key = autopilotKey(*game);
+            updateStats.measure([&] {
+                game->handleInput(key);
+                game->update();
+            });
+        }
+        updateStats.print("update", scale, blockCount);
+
+        NullRenderer nullOut(screenWidth, screenHeight);
+        FramebufferRenderer frameOut(screenWidth, screenHeight);
+        AnsiRenderer ansiOut(-1, screenWidth, screenHeight, AnsiRenderer::Features{true, false});
+        Renderer* targets[] = {&nullOut, &frameOut, &ansiOut};
+        const char* names[] = {"draw/null", "draw/framebuffer", "draw/ansi"};
+
+        for (int t = 0; t < 3; t++) {
+            game.reset();
+            FrameStats drawStats(frames);
+            for (int f = 0; f < frames; f++) {
+                nextGame();
+                game->update();
+                drawStats.measure([&] {
+                    game->draw(*targets[t]);
+                    targets[t]->present();
+                });
+            }
+            drawStats.print(names[t], scale, blockCount);
+        }
+        const AnsiRenderer::Counters& encodedTotals = ansiOut.getTotalCounters();
+        printf("  per frame, ansi encoder: attr switches %.1f  bytes %.1f\n",
+               static_cast<double>(encodedTotals.attrSwitches) / frames, static_cast<double>(encodedTotals.bytes) / frames);
+
+        // What a terminal would be sent for the same frames by ncurses' own
+        // update path and by the ANSI encoder, on an xterm
+        CursesCapture capture(screenWidth, screenHeight);
+        if (capture.isOpen()) {
+            initColors();
+            CursesRenderer cursesOut;
+            AnsiRenderer encoded(-1, screenWidth, screenHeight, AnsiRenderer::detectFeatures());
+            TeeRenderer both(cursesOut, encoded);
+            long long cursesStart = capture.getBytes();
+            game.reset();
+            for (int f = 0; f < frames; f++) {
+                nextGame();
+                game->update();
+                game->draw(both);
+                both.present();
+            }
+            printf("  per frame: bytes ncurses %.1f  ansi %.1f\n",
+                   static_cast<double>(capture.getBytes() - cursesStart) / frames,
+                   static_cast<double>(encoded.getTotalCounters().bytes) / frames);
+        }
+    }
+    return 0;
+}
+
+// Allocation check: plays with the autopilot, restarting after every game as
+// a player would, and draws each frame for the terminal and into the ANSI
+// encoder. Fails if any frame after the first allocates. A rally the
+// autopilot never loses is cut short so restarts are measured too.
+int runAllocCheck(int frames) {
+    const int kMaxGameFrames = 2000;
+    const int screenWidth = 80, screenHeight = 45;
+    NullRenderer terminal(screenWidth, screenHeight);
+    AnsiRenderer encoded(-1, screenWidth, screenHeight, AnsiRenderer::Features{true, true});
+    TeeRenderer out(terminal, encoded);
+    GameManager game(screenWidth, screenHeight);
+    AllocCheck check;
+    int games = 1, gameFrames = 0;
+
+    game.draw(out);
+    out.present();
+    while (check.getFrames() < frames) {
+        check.measure([&] {
+            if (game.isGameOver() || game.isGameWon() || ++gameFrames == kMaxGameFrames) {
+                game.reset();
+                games++;
+                gameFrames = 0;
+            }
+            game.handleInput(autopilotKey(game));
+            game.update();
+            game.draw(out);
+            out.present();
+        });
+    }
+
+    printf("games: %d\n", games);
+    return check.report(stdout, "alloc check");
+}
+
+// Replays a recorded session headlessly at full speed, one update per
+// recorded frame, with the game laid out for the recorded terminal size
+int runReplay(const char* path) {
+    InputReplay replay;
+    if (!replay.open(path)) {
+        fprintf(stderr, "cannot read input log %s\n", path);
+        return 1;
+    }
+
+    GameManager game(replay.getWidth(), replay.getHeight());
+    long long frame = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (!replay.finished(frame)) {
+        replay.keysAt(frame, [&](int key) { game.handleInput(key); });
+        game.update();
+        frame++;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("frames: %lld  %s  blocks remaining: %d  state: %016llx\n", frame,
+           game.isGameWon() ? "won" : (game.isGameOver() ? "game over" : "playing"), game.getBlocksRemaining(),
+           static_cast<unsigned long long>(game.stateHash()));
+    printf("wall: %.3fs  frames/s: %.0f\n", seconds, seconds > 0 ? frame / seconds : 0.0);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int benchFrames = 0;
+    int allocCheckFrames = 0;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    double frameRate = 60.0;
+    bool frameStats = false;
+    bool ansiOutput = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            benchFrames = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--alloc-check") == 0) {
+            allocCheckFrames = 10000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') allocCheckFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            frameRate = std::max(1.0, atof(argv[++i]));
+        } else if (strcmp(argv[i], "--frame-stats") == 0) {
+            frameStats = true;
+        } else if (strcmp(argv[i], "--ansi") == 0) {
+            ansiOutput = true;
+        } else {
+            fprintf(stderr, "usage: %s [--bench [frames]] [--alloc-check [frames]] [--record file] [--replay file] [--rate fps] [--frame-stats] [--ansi]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (benchFrames > 0) {
+        return runBenchmark(benchFrames);
+    }
+
+    if (allocCheckFrames > 0) {
+        return runAllocCheck(allocCheckFrames);
+    }
+
+    if (replayPath) {
+        return runReplay(replayPath);
+    }
+
+    // Initialize ncurses
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);  // Hide cursor
+    nodelay(stdscr, TRUE);  // Non-blocking input
+    
+    initColors();
 
     // Get terminal dimensions
     int maxY, maxX;
     getmaxyx(stdscr, maxY, maxX);
 
     // Create game manager
+    // Frames go out through ncurses, or with --ansi through the encoder,
+    // which writes to the terminal itself
+    CursesRenderer terminal;
+    AnsiRenderer encoded(STDOUT_FILENO, maxX, maxY, AnsiRenderer::detectFeatures());
+    Renderer& renderer = ansiOutput ? static_cast<Renderer&>(encoded) : terminal;
+    if (ansiOutput) refresh(); // ncurses switches to the alternate screen on its first refresh
     GameManager game(maxX, maxY);
+
+    // Keys are logged with the number of updates run before they were applied
+    InputRecorder recorder;
+    if (recordPath && !recorder.open(recordPath, 0, maxX, maxY)) {
+        endwin();
+        fprintf(stderr, "cannot write input log %s\n", recordPath);
+        return 1;
+    }
+    long long frame = 0;
     
-    // Game loop
+    // Game loop. Updates run once per frame while the game is in play; once
+    // it is over nothing moves, so the loop blocks until a key comes in.
+    // A few late updates are caught up so the game keeps its speed
+    FrameClock frameClock(frameRate);
     bool running = true;
     while (running) {
         // Process all available input
         int ch;
-        mvprintw(maxY / 2, maxX / 2 - 5, "         ");
-        mvprintw(maxY / 2 + 1, maxX / 2 - 11, "                      ");
-        attroff(COLOR_PAIR(1));
+        renderer.print(maxY / 2, maxX / 2 - 5, "         ");
+        renderer.print(maxY / 2 + 1, maxX / 2 - 11, "                      ");
         while ((ch = getch()) != ERR) {
             if (ch == 'q' || ch == 'Q') {
                 running = false;
                 break;
             } else {
                 game.handleInput(ch);
+                recorder.record(frame, ch);
             }
         }
-        
-        // Update game state
-         game.update();
-        
-        // Draw the game
-        game.draw();
+        if (!running) break;
+
+        // Update game state for every frame that has come due; a key can wake
+        // the loop early
+        while (!game.isGameOver() && !game.isGameWon() && frameClock.tick()) {
+            game.update();
+            frame++;
+        }
 
-        // Refresh screen and control frame rate
-        refresh();
-        usleep(16667);  // ~60 FPS (1,000,000 microseconds / 60)
+        // Draw the game
+        game.draw(renderer);
+        renderer.present();
+
+        if (game.isGameOver() || game.isGameWon()) {
+            waitForInput();
+            frameClock.restart();
+        } else {
+            waitForInput(frameClock.getNext());
+        }
     }
 
+    recorder.finish(frame);
+
     // Clean up
     endwin();
+    if (frameStats) frameClock.printStats(stdout);
     return 0;
 }
@@ -0,0 +1,71 @@
+#ifndef DAMAGE_TRACKER_H
+#define DAMAGE_TRACKER_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "renderer.h"
+
+// Tracks the sprite layer of the screen between frames. Each frame draws its
+// sprites into a fresh cell buffer and flush() writes only the cells that
+// differ from the previous frame, blanking cells a sprite has left. Nothing
+// else is touched, so static content drawn once (like the battle box) stays
+// on screen. The cells drawn this frame and last are kept in lists, and
+// flush() visits only those, so the work per frame follows the number of
+// sprites instead of screen size.
+class DamageTracker {
+private:
+    int width, height;
+    std::vector<chtype> previous; // What the last flush left on screen, 0 = no sprite
+    std::vector<chtype> current;  // This frame's sprites
+    std::vector<int> drawn;       // Cells put this frame, each once
+    std::vector<int> lastDrawn;   // Cells the last flush left a sprite in
+    int cellsWritten;             // Cells emitted by the last flush
+
+public:
+    // The lists can hold every cell, so drawing never allocates
+    DamageTracker(int w, int h) :
+        width(w), height(h), previous(static_cast<size_t>(w) * h, 0), current(static_cast<size_t>(w) * h, 0),
+        cellsWritten(0) {
+        drawn.reserve(current.size());
+        lastDrawn.reserve(current.size());
+    }
+
+    // Cells off the screen are dropped
+    void put(int y, int x, chtype ch) {
+        if (x < 0 || y < 0 || x >= width || y >= height) return;
+        int i = y * width + x;
+        if (!current[i]) drawn.push_back(i);
+        current[i] = ch;
+    }
+
+    // Writes the changed cells to out and starts a new, empty frame
+    void flush(Renderer& out) {
+        cellsWritten = 0;
+        for (int i : lastDrawn) {
+            if (!current[i]) {
+                out.putChar(i / width, i % width, ' ');
+                cellsWritten++;
+            }
+        }
+        for (int i : drawn) {
+            if (current[i] && current[i] != previous[i]) {
+                out.putChar(i / width, i % width, current[i]);
+                cellsWritten++;
+            }
+        }
+
+        // Only sprites drawn this frame are on screen now
+        for (int i : lastDrawn) previous[i] = 0;
+        for (int i : drawn) {
+            previous[i] = current[i];
+            current[i] = 0;
+        }
+        std::swap(lastDrawn, drawn);
+        drawn.clear();
+    }
+
+    int getCellsWritten() const { return cellsWritten; }
+};
+
+#endif
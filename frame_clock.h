@@ -0,0 +1,137 @@
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+// Frame pacing for the interactive loops. Frames are due on a fixed grid of
+// absolute deadlines (start + n * interval), so time spent doing a frame's
+// work never pushes the later frames back and the rate does not drift.
+// A loop either sleeps to the next deadline outright with sleep(), or blocks
+// on the terminal with waitForInput() so a key is handled as soon as it is
+// typed. A game with nothing left to animate can wait with no timeout at all.
+
+// Blocks until stdin has input or the deadline passes. Returns true when
+// input is waiting. A signal (SIGWINCH on resize) also ends the wait early.
+inline bool waitForInput(std::chrono::steady_clock::time_point deadline) {
+    std::chrono::steady_clock::duration left = deadline - std::chrono::steady_clock::now();
+    if (left < std::chrono::steady_clock::duration::zero()) left = std::chrono::steady_clock::duration::zero();
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+
+    struct pollfd terminal = {STDIN_FILENO, POLLIN, 0};
+    struct timespec timeout = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+    return ppoll(&terminal, 1, &timeout, nullptr) > 0;
+}
+
+// Blocks until stdin has input, for as long as that takes
+inline bool waitForInput() {
+    struct pollfd terminal = {STDIN_FILENO, POLLIN, 0};
+    return ppoll(&terminal, 1, nullptr, nullptr) > 0;
+}
+
+// Fixed-rate frame deadlines with running statistics on how well they are met
+class FrameClock {
+private:
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point next;      // When the next frame is due
+    std::chrono::steady_clock::time_point lastFrame; // When tick() last returned true
+    int maxCatchUp; // Late frames that may run back to back before the backlog is dropped
+    bool timing;    // lastFrame is set, so the next frame's period can be measured
+
+    long long frames;
+    long long missed;   // Frames that started a whole interval or more after their deadline
+    long long dropped;  // Frames skipped outright to get back on schedule
+    long long periods;                  // Frame periods measured (none across a restart())
+    double periodSum, periodSumSquares; // Seconds between frame starts
+    double maxLate;                     // Seconds, worst start after a deadline
+
+public:
+    explicit FrameClock(double rate, int maxCatchUp = 4)
+        : interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate))),
+          next(std::chrono::steady_clock::now()), lastFrame(next), maxCatchUp(maxCatchUp), timing(false),
+          frames(0), missed(0), dropped(0), periods(0), periodSum(0), periodSumSquares(0), maxLate(0) {}
+
+    // True when the next frame has come due, once per deadline. A loop that
+    // fell behind gets true back to back until it has caught up, as long as it
+    // is at most maxCatchUp frames behind; beyond that the backlog is dropped
+    // and the schedule carries on from the current time slot.
+    bool tick() {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now < next) return false;
+
+        double late = std::chrono::duration<double>(now - next).count();
+        if (now - next >= interval) missed++;
+        if (late > maxLate) maxLate = late;
+        if (timing) {
+            double period = std::chrono::duration<double>(now - lastFrame).count();
+            periods++;
+            periodSum += period;
+            periodSumSquares += period * period;
+        }
+        lastFrame = now;
+        timing = true;
+        frames++;
+
+        next += interval;
+        if (now - next >= interval * maxCatchUp) {
+            long long behind = (now - next) / interval + 1;
+            dropped += behind;
+            next += interval * behind;
+        }
+        return true;
+    }
+
+    // Sleeps until the next deadline. The deadline is absolute, so a wakeup
+    // that comes late is not carried into the frame after.
+    void sleep() const {
+        // libstdc++ measures steady_clock on CLOCK_MONOTONIC, so the deadline
+        // converts directly
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch()).count();
+        struct timespec deadline = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+    }
+
+    // Starts the schedule afresh from now. For a loop that sat idle on
+    // purpose, so the wait is not counted as missed or dropped frames.
+    void restart() {
+        next = std::chrono::steady_clock::now();
+        timing = false;
+    }
+
+    std::chrono::steady_clock::time_point getNext() const { return next; }
+
+    long long getFrames() const { return frames; }
+    long long getMissed() const { return missed; }
+    long long getDropped() const { return dropped; }
+    double getTargetPeriodMs() const { return std::chrono::duration<double, std::milli>(interval).count(); }
+    double getMeanPeriodMs() const { return periods > 0 ? periodSum / periods * 1e3 : 0.0; }
+    double getMaxLateMs() const { return maxLate * 1e3; }
+
+    // Standard deviation of the frame period
+    double getJitterMs() const {
+        if (periods < 2) return 0.0;
+        double n = static_cast<double>(periods);
+        double mean = periodSum / n;
+        return std::sqrt(std::max(0.0, periodSumSquares / n - mean * mean)) * 1e3;
+    }
+
+    // One-line summary, for the screen or a dump at exit
+    int describe(char* text, size_t size) const {
+        return snprintf(text, size, "frames %lld  period %.2f/%.2f ms  jitter %.2f ms  late max %.2f ms  missed %lld  dropped %lld",
+                        frames, getMeanPeriodMs(), getTargetPeriodMs(), getJitterMs(), getMaxLateMs(), missed, dropped);
+    }
+
+    void printStats(FILE* out) const {
+        char text[160];
+        describe(text, sizeof(text));
+        fprintf(out, "%s\n", text);
+    }
+};
+
+#endif
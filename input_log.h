@@ -0,0 +1,168 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Recorded input sessions. A log holds the game seed, the terminal size the
+// game was laid out for, the number of balls it started with, and every key
+// stamped with the simulation step it was applied before. Feeding the same
+// keys at the same steps into a game built from the same seed, size and ball
+// count reproduces the session exactly.
+//
+// File layout: "INP2", then varints for seed, width, height and ball count,
+// then one (step delta, key + 1) varint pair per key. A pair with key + 1 == 0
+// ends the log and its step is the step the session stopped at. Logs tagged
+// "INPT" are the earlier layout without the ball count, and start one ball.
+
+inline void writeVarint(FILE* file, uint64_t value) {
+    while (value >= 0x80) {
+        fputc(static_cast<int>((value & 0x7f) | 0x80), file);
+        value >>= 7;
+    }
+    fputc(static_cast<int>(value), file);
+}
+
+// FNV-1a, used to fingerprint game state at the end of a replay
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t h = 1469598103934665603ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+class InputRecorder {
+private:
+    FILE* file;
+    long long lastStep;
+
+public:
+    InputRecorder() : file(nullptr), lastStep(0) {}
+    ~InputRecorder() { finish(lastStep); }
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    bool open(const char* path, uint32_t seed, int width, int height, int balls = 1) {
+        file = fopen(path, "wb");
+        if (!file) return false;
+        fputs("INP2", file);
+        writeVarint(file, seed);
+        writeVarint(file, static_cast<uint32_t>(width));
+        writeVarint(file, static_cast<uint32_t>(height));
+        writeVarint(file, static_cast<uint32_t>(balls));
+        lastStep = 0;
+        return true;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Steps must not go backwards
+    void record(long long step, int key) {
+        if (!file) return;
+        writeVarint(file, static_cast<uint64_t>(step - lastStep));
+        writeVarint(file, static_cast<uint64_t>(static_cast<uint32_t>(key) + 1));
+        lastStep = step;
+    }
+
+    // Writes the end marker and closes the file
+    void finish(long long endStep) {
+        if (!file) return;
+        writeVarint(file, static_cast<uint64_t>(endStep - lastStep));
+        writeVarint(file, 0);
+        fclose(file);
+        file = nullptr;
+    }
+};
+
+class InputReplay {
+private:
+    std::vector<unsigned char> data;
+    size_t pos;
+    uint32_t seed;
+    int width, height;
+    int balls;
+    long long nextStep; // Step of the pending entry
+    int nextKey;        // Pending key, or -1 once the end marker is reached
+    bool valid;
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+            unsigned char byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void readEntry() {
+        uint64_t delta, key;
+        if (!readVarint(delta) || !readVarint(key)) {
+            nextKey = -1; // Truncated log: stop where it breaks off
+            return;
+        }
+        nextStep += static_cast<long long>(delta);
+        nextKey = key == 0 ? -1 : static_cast<int>(static_cast<uint32_t>(key - 1));
+    }
+
+public:
+    InputReplay() : pos(0), seed(0), width(0), height(0), balls(1), nextStep(0), nextKey(-1), valid(false) {}
+
+    bool open(const char* path) {
+        FILE* file = fopen(path, "rb");
+        if (!file) return false;
+        data.clear();
+        int c;
+        while ((c = fgetc(file)) != EOF) {
+            data.push_back(static_cast<unsigned char>(c));
+        }
+        fclose(file);
+
+        pos = 0;
+        if (data.size() < 4 || data[0] != 'I' || data[1] != 'N' || data[2] != 'P') return false;
+        if (data[3] != 'T' && data[3] != '2') return false;
+        bool hasBalls = data[3] == '2';
+        pos = 4;
+
+        uint64_t s, w, h, b = 1;
+        if (!readVarint(s) || !readVarint(w) || !readVarint(h)) return false;
+        if (hasBalls && !readVarint(b)) return false;
+        seed = static_cast<uint32_t>(s);
+        width = static_cast<int>(w);
+        height = static_cast<int>(h);
+        balls = static_cast<int>(b);
+
+        nextStep = 0;
+        readEntry();
+        valid = true;
+        return true;
+    }
+
+    uint32_t getSeed() const { return seed; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getBalls() const { return balls; }
+
+    // Calls apply(key) for every key recorded at this step
+    template <typename Fn>
+    void keysAt(long long step, Fn apply) {
+        while (valid && nextKey >= 0 && nextStep == step) {
+            apply(nextKey);
+            readEntry();
+        }
+    }
+
+    // Step of the next recorded key, or of the end marker once keys run out
+    long long getNextStep() const { return nextStep; }
+
+    // True once the recorded session has been played out up to its last step
+    bool finished(long long step) const {
+        return !valid || (nextKey < 0 && step >= nextStep);
+    }
+};
+
+#endif
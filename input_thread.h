@@ -0,0 +1,184 @@
+#ifndef INPUT_THREAD_H
+#define INPUT_THREAD_H
+
+#include <ncursesw/ncurses.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include "spsc_queue.h"
+
+// A key and the moment its bytes were read from the terminal
+struct InputEvent {
+    int key; // A character, or KEY_LEFT / KEY_RIGHT / KEY_UP / KEY_DOWN for arrows
+    std::chrono::steady_clock::time_point time;
+};
+
+// Reads the terminal on its own thread so keys are timestamped when they
+// arrive rather than when the frame loop next gets round to polling. Raw
+// bytes are read in batches and decoded here (ncurses is not thread-safe, so
+// getch() is off limits); the events go to the game thread through a
+// lock-free queue, and a byte on a pipe wakes it if it is waiting.
+//
+// While the thread runs it owns stdin: nothing else may call getch().
+class InputThread {
+private:
+    static const int kEscapeTimeoutMs = 25; // A lone ESC with nothing after it for this long is the Escape key
+
+    SpscQueue<InputEvent, 256> queue;
+    std::thread reader;
+    int wakePipe[2];  // Reader writes a byte after pushing events; wait() polls the read end
+    int stopPipe[2];  // stop() writes a byte to end the reader
+    unsigned char pending[16]; // Start of an escape sequence split across reads
+    size_t pendingLength;
+    std::atomic<long long> dropped; // Keys lost to a full queue
+
+    void emit(int key, std::chrono::steady_clock::time_point time, bool& any) {
+        if (queue.push(InputEvent{key, time})) {
+            any = true;
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static int arrowKey(unsigned char final) {
+        switch (final) {
+            case 'A': return KEY_UP;
+            case 'B': return KEY_DOWN;
+            case 'C': return KEY_RIGHT;
+            case 'D': return KEY_LEFT;
+        }
+        return ERR;
+    }
+
+    // Decodes bytes into events. Arrows arrive as ESC [ x or, with the keypad
+    // in application mode, ESC O x, possibly with modifier parameters before
+    // the final byte; other escape sequences are skipped. Returns how many
+    // bytes were used; the rest are an unfinished sequence.
+    size_t decode(const unsigned char* bytes, size_t length, std::chrono::steady_clock::time_point time, bool& any) {
+        size_t i = 0;
+        while (i < length) {
+            if (bytes[i] != 27) {
+                emit(bytes[i++], time, any);
+                continue;
+            }
+            if (i + 1 >= length) break; // ESC alone so far
+            if (bytes[i + 1] != '[' && bytes[i + 1] != 'O') {
+                emit(27, time, any); // Escape, then an ordinary key
+                i++;
+                continue;
+            }
+
+            size_t end = i + 2;
+            while (end < length && (bytes[end] < 0x40 || bytes[end] > 0x7e)) end++;
+            if (end >= length) break; // Final byte still to come
+
+            int key = arrowKey(bytes[end]);
+            if (key != ERR) emit(key, time, any);
+            i = end + 1;
+        }
+        return i;
+    }
+
+    void run() {
+        unsigned char buffer[256];
+        for (;;) {
+            struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+            int ready = poll(fds, 2, pendingLength > 0 ? kEscapeTimeoutMs : -1);
+            if (fds[1].revents) return;
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            bool any = false;
+
+            if (ready == 0 && pendingLength > 0) {
+                // Nothing followed: the pending bytes were keys, not a sequence
+                for (size_t i = 0; i < pendingLength; i++) emit(pending[i], now, any);
+                pendingLength = 0;
+            } else if (ready > 0 && (fds[0].revents & POLLIN)) {
+                memcpy(buffer, pending, pendingLength);
+                ssize_t got = read(STDIN_FILENO, buffer + pendingLength, sizeof(buffer) - pendingLength);
+                if (got <= 0) return;
+                size_t length = pendingLength + static_cast<size_t>(got);
+                size_t used = decode(buffer, length, now, any);
+
+                // Keep an unfinished sequence for the next read, unless it is
+                // too long to be one
+                pendingLength = length - used;
+                if (pendingLength > sizeof(pending)) {
+                    used = length;
+                    pendingLength = 0;
+                }
+                memcpy(pending, buffer + used, pendingLength);
+            } else if (ready > 0 && (fds[0].revents & (POLLHUP | POLLERR))) {
+                return;
+            }
+
+            if (any) {
+                char byte = 0;
+                ssize_t ignored = write(wakePipe[1], &byte, 1);
+                (void)ignored;
+            }
+        }
+    }
+
+public:
+    InputThread() : pendingLength(0), dropped(0) {
+        if (pipe(wakePipe) != 0 || pipe(stopPipe) != 0) {
+            wakePipe[0] = wakePipe[1] = stopPipe[0] = stopPipe[1] = -1;
+        }
+        // The wake pipe is only a doorbell; a full one already rings
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+
+    ~InputThread() {
+        stop();
+        for (int fd : {wakePipe[0], wakePipe[1], stopPipe[0], stopPipe[1]}) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    InputThread(const InputThread&) = delete;
+    InputThread& operator=(const InputThread&) = delete;
+
+    bool start() {
+        if (stopPipe[0] < 0) return false;
+        reader = std::thread(&InputThread::run, this);
+        return true;
+    }
+
+    void stop() {
+        if (!reader.joinable()) return;
+        char byte = 0;
+        ssize_t ignored = write(stopPipe[1], &byte, 1);
+        (void)ignored;
+        reader.join();
+    }
+
+    // Oldest undelivered event, or nullptr. Game thread only.
+    const InputEvent* peek() const { return queue.front(); }
+    void pop() { queue.pop(); }
+
+    // Blocks until new events arrive or the deadline passes. Returns true
+    // when woken by input.
+    bool wait(std::chrono::steady_clock::time_point deadline) {
+        std::chrono::steady_clock::duration left = deadline - std::chrono::steady_clock::now();
+        if (left < std::chrono::steady_clock::duration::zero()) left = std::chrono::steady_clock::duration::zero();
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+
+        struct pollfd bell = {wakePipe[0], POLLIN, 0};
+        struct timespec timeout = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+        if (ppoll(&bell, 1, &timeout, nullptr) <= 0) return false;
+
+        char drain[64];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+        return true;
+    }
+
+    long long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif
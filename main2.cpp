@@ -1,7 +1,17 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <cmath>
 #include <ncursesw/ncurses.h>
 #include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include "occupancy_grid.h"
+#include "object_pool.h"
+#include "damage_tracker.h"
+#include "bench.h"
+#include "frame_clock.h"
 
 class Bullet {
 public:
@@ -23,69 +33,114 @@ public:
     void move(int dx) { x += dx; }
 };
 
-void drawPlayer(const Player& player) {
-    mvaddch(player.y, player.x, ACS_CKBOARD); // Player representation
+void drawPlayer(DamageTracker& screen, const Player& player) {
+    screen.put(player.y, player.x, ACS_CKBOARD); // Player representation
 }
 
-void drawBullet(const Bullet& bullet) {
-    mvaddch(bullet.y, bullet.x, '|'); // Bullet representation
+void drawBullet(DamageTracker& screen, const Bullet& bullet) {
+    screen.put(bullet.y, bullet.x, '|'); // Bullet representation
 }
 
-void drawEnemy(const Enemy& enemy) {
-    mvaddch(enemy.y, enemy.x, '#'); // Enemy representation
-}
-
-bool checkCollision(const Bullet& bullet, const Enemy& enemy) {
-    return bullet.x == enemy.x && bullet.y == enemy.y;
+void drawEnemy(DamageTracker& screen, const Enemy& enemy) {
+    screen.put(enemy.y, enemy.x, '#'); // Enemy representation
 }
 
 class Game {
 private:
     Player player;
-    std::vector<Bullet> bullets;
+    ObjectPool<Bullet> bullets; // Fixed capacity, bullets are recycled once spent
     std::vector<Enemy> enemies;
+    OccupancyGrid enemyGrid; // Enemy slot by screen cell
+    DamageTracker screen;    // Sprite cells drawn last frame
     int score;
     int boxX, boxY; // Battle box position
 
 public:
-    Game(int startX, int startY) : player(startX + 20, startY + 14), score(0), boxX(startX), boxY(startY) {
+    Game(int startX, int startY, int screenWidth, int screenHeight, int maxBullets, int enemyRows = 5,
+         int enemyCols = 10) :
+        player(startX + 20, startY + std::max(14, enemyRows + 9)), bullets(maxBullets),
+        screen(screenWidth, screenHeight), score(0), boxX(startX), boxY(startY) {
         // Create enemies
-        for (int i = 0; i < 5; i++) {
-            for (int j = 0; j < 10; j++) {
+        for (int i = 0; i < enemyRows; i++) {
+            for (int j = 0; j < enemyCols; j++) {
                 enemies.emplace_back(startX + j * 6 + 5, startY + i + 1); // Simple grid formation
             }
         }
+        buildEnemyGrid();
+    }
+
+    // Maps every enemy's cell to its slot, sized to the formation's bounding box
+    void buildEnemyGrid() {
+        if (enemies.empty()) {
+            enemyGrid.resize(0, 0, 0, 0);
+            return;
+        }
+        int minX = enemies[0].x, maxX = enemies[0].x;
+        int minY = enemies[0].y, maxY = enemies[0].y;
+        for (auto& enemy : enemies) {
+            minX = std::min(minX, enemy.x);
+            maxX = std::max(maxX, enemy.x);
+            minY = std::min(minY, enemy.y);
+            maxY = std::max(maxY, enemy.y);
+        }
+        enemyGrid.resize(minX, minY, maxX - minX + 1, maxY - minY + 1);
+        for (int i = 0; i < static_cast<int>(enemies.size()); i++) {
+            enemyGrid.set(enemies[i].x, enemies[i].y, i);
+        }
+    }
+
+    // Swap-and-pop: the last enemy takes the freed slot, so removal is O(1)
+    void removeEnemy(int slot) {
+        int last = static_cast<int>(enemies.size()) - 1;
+        enemyGrid.clear(enemies[slot].x, enemies[slot].y);
+        if (slot != last) {
+            enemies[slot] = enemies[last];
+            enemyGrid.set(enemies[slot].x, enemies[slot].y, slot);
+        }
+        enemies.pop_back();
     }
 
     void update() {
-        for (int i = 0; i < bullets.size(); i++) {
+        // Move bullets; a hit is a single lookup in the enemy grid
+        size_t i = 0;
+        while (i < bullets.size()) {
             bullets[i].move();
-            for (int j = 0; j < enemies.size(); j++) {
-                if (checkCollision(bullets[i], enemies[j])) {
-                    bullets.erase(bullets.begin() + i);
-                    enemies.erase(enemies.begin() + j);
-                    score++;
-                    i--;
-                    break;
-                }
+            int slot = enemyGrid.get(bullets[i].x, bullets[i].y);
+            if (slot >= 0) {
+                removeEnemy(slot);
+                // The last bullet moves into slot i and has not moved yet this frame
+                bullets.release(i);
+                score++;
+            } else if (bullets[i].y <= boxY) { // Reached the top of the battle box
+                bullets.release(i);
+            } else {
+                i++;
             }
         }
     }
 
-    void draw() {
-        clear();
-        drawPlayer(player);
+    void draw(Renderer& out) {
+        // No clear(): only the sprite cells that changed are rewritten
+        drawPlayer(screen, player);
         for (auto& bullet : bullets) {
-            drawBullet(bullet);
+            drawBullet(screen, bullet);
         }
         for (auto& enemy : enemies) {
-            drawEnemy(enemy);
+            drawEnemy(screen, enemy);
         }
-        mvprintw(0, 0, "Score: %d", score);
-        refresh();
+        screen.flush(out);
+        int length = out.print(0, 0, "Score: %d  Bullets: %zu/%zu  Recycled: %llu  Cells: %d", score,
+                               bullets.size(), bullets.getCapacity(), bullets.getRecycled(),
+                               screen.getCellsWritten());
+        out.clearToEol(0, length);
+        out.present();
     }
 
-    void handleInput(int ch) {
+    int getEnemyCount() const { return static_cast<int>(enemies.size()); }
+    const Player& getPlayer() const { return player; }
+
+    // Returns false once the player asks to quit
+    bool handleInput(int ch) {
         switch (ch) {
             case KEY_LEFT:
                 if (player.x > boxX) player.move(-1);
@@ -94,12 +149,12 @@ public:
                 if (player.x < boxX + 39) player.move(1);
                 break;
             case ' ':
-                bullets.emplace_back(player.x, player.y - 1); // Shoot bullet
+                bullets.spawn(player.x, player.y - 1); // Shoot bullet, ignored while the pool is full
                 break;
             case 'q':
-                endwin();
-                exit(0);
+                return false;
         }
+        return true;
     }
 };
 
@@ -113,26 +168,23 @@ public:
     BattleBox(int startX, int startY, int w, int h) :
         x(startX), y(startY), width(w), height(h), needsRedraw(true) {}
 
-    void draw() {
+    void draw(Renderer& out) {
         if (!needsRedraw) return;
         
-        // Enable reverse highlighting
-        attron(A_REVERSE);
+        // Borders are reverse-highlighted spaces
+        chtype border = ' ' | A_REVERSE;
     
         // Draw the top and bottom borders of the battle box
         for (int i = -1; i <= width; i++) {
-            mvaddch(y, x + i, ' ');              // Top border
-            mvaddch(y + height, x + i, ' ');     // Bottom border
+            out.putChar(y, x + i, border);              // Top border
+            out.putChar(y + height, x + i, border);     // Bottom border
         }
     
         // Draw the left and right borders of the battle box
         for (int i = 0; i <= height; i++) {
-            mvaddch(y + i, x, ' ');              // Left border
-            mvaddch(y + i, x + width, ' ');      // Right border
+            out.putChar(y + i, x, border);              // Left border
+            out.putChar(y + i, x + width, border);      // Right border
         }
-    
-        // Disable reverse highlighting
-        attroff(A_REVERSE);
         
         needsRedraw = false;
     }
@@ -141,7 +193,136 @@ public:
     int getY() const { return y; }
 };
 
-int main() {
+// Benchmark mode: times update and draw at scaled entity counts. Scale k has
+// k times the 50 enemies of the usual formation and fires k shots a frame into
+// a bullet pool k times the default size.
+int runBenchmark(int frames) {
+    FrameStats::printHeader();
+
+    for (int scale : kBenchScales) {
+        int rows = std::max(1, static_cast<int>(5 * std::sqrt(static_cast<float>(scale))));
+        int cols = (50 * scale + rows - 1) / rows;
+        int screenWidth = cols * 6 + 10;
+        int screenHeight = rows + 25;
+        long long enemyCount = static_cast<long long>(rows) * cols;
+
+        // Games are replaced outside the timed region once half the formation is gone
+        std::unique_ptr<Game> game;
+        auto nextGame = [&]() {
+            if (!game || game->getEnemyCount() < enemyCount / 2) {
+                game.reset(new Game(1, 1, screenWidth, screenHeight, 64 * scale, rows, cols));
+            }
+        };
+
+        // Sweeps the player back and forth, firing at every step
+        int direction = KEY_RIGHT;
+        auto fire = [&]() {
+            for (int shot = 0; shot < scale; shot++) {
+                int x = game->getPlayer().x;
+                if (x <= 1) direction = KEY_RIGHT;
+                if (x >= 1 + 39) direction = KEY_LEFT;
+                game->handleInput(direction);
+                game->handleInput(' ');
+            }
+        };
+
+        FrameStats updateStats(frames);
+        for (int f = 0; f < frames; f++) {
+            nextGame();
+            updateStats.measure([&] {
+                fire();
+                game->update();
+            });
+        }
+        updateStats.print("update", scale, enemyCount);
+
+        NullRenderer nullOut(screenWidth, screenHeight);
+        FramebufferRenderer frameOut(screenWidth, screenHeight);
+        Renderer* targets[] = {&nullOut, &frameOut};
+        const char* names[] = {"draw/null", "draw/framebuffer"};
+
+        for (int t = 0; t < 2; t++) {
+            game.reset();
+            FrameStats drawStats(frames);
+            for (int f = 0; f < frames; f++) {
+                nextGame();
+                fire();
+                game->update();
+                drawStats.measure([&] {
+                    game->draw(*targets[t]);
+                });
+            }
+            drawStats.print(names[t], scale, enemyCount);
+        }
+    }
+    return 0;
+}
+
+// Allocation check: sweeps the player back and forth firing every frame, as
+// the benchmark does, and draws each frame. Fails if any frame allocates.
+// A cleared formation is replaced by a new game between frames.
+int runAllocCheck(int frames) {
+    const int screenWidth = 80, screenHeight = 30;
+    FramebufferRenderer out(screenWidth, screenHeight);
+    std::unique_ptr<Game> game;
+    AllocCheck check;
+    int games = 0;
+    int direction = KEY_RIGHT;
+
+    while (check.getFrames() < frames) {
+        if (!game || game->getEnemyCount() == 0) {
+            game.reset(new Game(1, 1, screenWidth, screenHeight, 64));
+            games++;
+        }
+        check.measure([&] {
+            int x = game->getPlayer().x;
+            if (x <= 1) direction = KEY_RIGHT;
+            if (x >= 1 + 39) direction = KEY_LEFT;
+            game->handleInput(direction);
+            game->handleInput(' ');
+            game->update();
+            game->draw(out);
+        });
+    }
+
+    printf("games: %d\n", games);
+    return check.report(stdout, "alloc check");
+}
+
+int main(int argc, char* argv[]) {
+    int maxBullets = 64;
+    int benchFrames = 0;
+    int allocCheckFrames = 0;
+    double frameRate = 10.0;
+    bool frameStats = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-bullets") == 0 && i + 1 < argc) {
+            maxBullets = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchFrames = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--alloc-check") == 0) {
+            allocCheckFrames = 10000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') allocCheckFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            frameRate = std::max(1.0, atof(argv[++i]));
+        } else if (strcmp(argv[i], "--frame-stats") == 0) {
+            frameStats = true;
+        } else {
+            fprintf(stderr, "usage: %s [--max-bullets n] [--bench [frames]] [--alloc-check [frames]] [--rate fps] [--frame-stats]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (benchFrames > 0) {
+        return runBenchmark(benchFrames);
+    }
+
+    if (allocCheckFrames > 0) {
+        return runAllocCheck(allocCheckFrames);
+    }
+
     initscr();
     cbreak();
     noecho();
@@ -154,18 +335,27 @@ int main() {
 
     // Create battle box
     BattleBox battleBox(maxX/2 - 20, maxY/2 - 8, 40, 16);
-    battleBox.draw();
+    CursesRenderer renderer;
+    battleBox.draw(renderer);
 
-    Game game(battleBox.getX(), battleBox.getY());
+    Game game(battleBox.getX(), battleBox.getY(), maxX, maxY, maxBullets);
 
-    while (true) {
-        int ch = getch();
-        game.handleInput(ch);
-        game.update();
-        game.draw();
-        usleep(100000); // Control game speed
+    // The game moves one step per frame, so the rate sets its speed
+    FrameClock frameClock(frameRate);
+    bool running = true;
+    while (running) {
+        // One key and one update per frame. Frames that came due while the
+        // last one ran late are caught up back to back.
+        while (running && frameClock.tick()) {
+            running = game.handleInput(getch());
+            if (running) game.update();
+        }
+        if (!running) break;
+        game.draw(renderer);
+        frameClock.sleep();
     }
 
     endwin();
+    if (frameStats) frameClock.printStats(stdout);
     return 0;
 }
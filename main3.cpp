@@ -5,6 +5,38 @@
 #include <vector>
 #include <ctime>
 #include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include <thread>
+#include "spatial_grid.h"
+#include "renderer.h"
+#include "static_layer.h"
+#include "ansi_renderer.h"
+#include "frame_clock.h"
+#include "input_thread.h"
+#include "bench.h"
+#include "random_source.h"
+#include "input_log.h"
+#include "sweep.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
+#include "sort_and_sweep.h"
+#include "aabb_batch.h"
+
+// Simulation runs at a fixed step; rendering interpolates between the last two steps
+const float kSimStep = 1.0f / 240.0f;
+const float kMaxFrameTime = 0.25f;   // Longest stall the simulation will try to catch up on
+const float kKeyMoveTime = 1.0f / 60.0f; // Paddle travel per key press, in seconds of movement
+const int kMaxBouncesPerStep = 8;     // Contacts resolved in one step before the rest of the move is dropped
+const int kParallelMinBalls = 64;     // Fewer balls than this are not worth waking the thread pool for
+const float kSplitAngle = 0.5f;       // Radians either side of its course a multi-ball power-up sends new balls
+const int kMaxQuietSteps = 240;       // Event-driven mode: most steps a ball flies between sweeps
+const float kWakeMargin = 0.01f;      // Event-driven mode: cells of slack around anything a ball could meet
 
 // Vector2D class for positions and velocities
 class Vector2D {
@@ -20,46 +52,41 @@ public:
     Vector2D operator*(float scalar) const {
         return Vector2D(x * scalar, y * scalar);
     }
+
+    static Vector2D lerp(const Vector2D& from, const Vector2D& to, float t) {
+        return Vector2D(from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t);
+    }
 };
 
-// Game object base class
+// What every moving thing in the game has: a box and where it was a step
+// ago. The derived types are used by value and never through a base pointer,
+// so nothing is virtual.
 class GameObject {
 protected:
     Vector2D position;
+    Vector2D previousPosition; // Position at the start of the last simulation step
     Vector2D size;
     bool active;
-    int lastDrawnX, lastDrawnY;
 
 public:
     GameObject(float x, float y, float width, float height)
-        : position(x, y), size(width, height), active(true),
-          lastDrawnX(static_cast<int>(round(x))), lastDrawnY(static_cast<int>(round(y))) {}
-
-    virtual ~GameObject() {}
+        : position(x, y), previousPosition(x, y), size(width, height), active(true) {}
 
     bool isActive() const { return active; }
     void setActive(bool state) { active = state; }
 
     Vector2D getPosition() const { return position; }
+    Vector2D getPreviousPosition() const { return previousPosition; }
     Vector2D getSize() const { return size; }
 
+    void storePrevious() { previousPosition = position; }
+
     bool collidesWith(const GameObject& other) const {
         return (position.x < other.position.x + other.size.x &&
                 position.x + size.x > other.position.x &&
                 position.y < other.position.y + other.size.y &&
                 position.y + size.y > other.position.y);
     }
-
-    void clearPrevious() {
-        for (int y = 0; y < static_cast<int>(size.y); y++) {
-            for (int x = 0; x < static_cast<int>(size.x); x++) {
-                mvaddch(lastDrawnY + y, lastDrawnX + x, ' ');
-            }
-        }
-    }
-
-    virtual void update(float deltaTime) = 0;
-    virtual void draw() = 0;
 };
 
 // Ball class
@@ -67,38 +94,44 @@ class Ball : public GameObject {
 private:
     Vector2D velocity;
     float speed;
-    int symbol;
+    int pendingHits[kMaxBouncesPerStep]; // Blocks hit during the parallel phase of a step
+    int pendingHitCount;
+    long long wakeStep;      // Event-driven mode: first step the ball must be swept again
 
 public:
-    Ball(float x, float y, float radius, float speed)
-        : GameObject(x, y, 1, 1), speed(speed), symbol(ACS_BULLET) {
-        float angle = (rand() % 60 + 30) * M_PI / 180.0f;
+    Ball(float x, float y, float radius, float speed, RandomSource& random)
+        : GameObject(x, y, 1, 1), speed(speed), pendingHits(), pendingHitCount(0), wakeStep(0) {
+        float angle = (random.nextInt(60) + 30) * M_PI / 180.0f;
         velocity = Vector2D(cos(angle), -sin(angle)) * speed;
     }
 
-    void update(float deltaTime) override {
-        position.x += velocity.x * deltaTime;
-        position.y += velocity.y * deltaTime;
+    // A copy of this ball heading off at an angle (radians) to its course
+    Ball split(float angle) const {
+        Ball copy(*this);
+        float c = std::cos(angle), s = std::sin(angle);
+        copy.velocity = Vector2D(velocity.x * c - velocity.y * s, velocity.x * s + velocity.y * c);
+        copy.pendingHitCount = 0;
+        copy.wakeStep = 0;
+        return copy;
     }
 
-    void draw() override {
-        int currentX = static_cast<int>(round(position.x));
-        int currentY = static_cast<int>(round(position.y));
-
-        if (currentX != lastDrawnX || currentY != lastDrawnY) {
-            clearPrevious();
-            attron(COLOR_PAIR(1));
-            mvaddch(currentY, currentX, symbol);
-            attroff(COLOR_PAIR(1));
-            lastDrawnX = currentX;
-            lastDrawnY = currentY;
-        }
+    void update(float deltaTime) {
+        position.x += velocity.x * deltaTime;
+        position.y += velocity.y * deltaTime;
     }
 
     void bounceX() { velocity.x = -velocity.x; }
     void bounceY() { velocity.y = -velocity.y; }
     Vector2D getVelocity() const { return velocity; }
     void setVelocity(Vector2D newVel) { velocity = newVel; }
+
+    void clearHits() { pendingHitCount = 0; }
+    void addHit(int blockIndex) { pendingHits[pendingHitCount++] = blockIndex; }
+    int getHitCount() const { return pendingHitCount; }
+    int getHit(int i) const { return pendingHits[i]; }
+
+    long long getWakeStep() const { return wakeStep; }
+    void setWakeStep(long long step) { wakeStep = step; }
 };
 
 // Paddle class
@@ -110,25 +143,6 @@ public:
     Paddle(float x, float y, float width, float height, float speed)
         : GameObject(x, y, width, height), speed(speed) {}
 
-    void update(float deltaTime) override {}
-
-    void draw() override {
-        int currentX = static_cast<int>(round(position.x));
-        int currentY = static_cast<int>(round(position.y));
-
-        if (currentX != lastDrawnX || currentY != lastDrawnY) {
-            clearPrevious();
-            lastDrawnX = currentX;
-            lastDrawnY = currentY;
-        }
-
-        attron(COLOR_PAIR(2));
-        for (int x = 0; x < static_cast<int>(size.x); x++) {
-            mvaddch(currentY, currentX + x, ACS_BLOCK);
-        }
-        attroff(COLOR_PAIR(2));
-    }
-
     void moveLeft(float deltaTime, float minX) {
         position.x -= speed * deltaTime;
         if (position.x < minX) position.x = minX;
@@ -140,46 +154,140 @@ public:
     }
 };
 
-// Block class
-class Block : public GameObject {
+// A block's new look, as logged by BlockStore for the drawing side
+struct BlockChange {
+    int16_t x, y;
+    uint8_t width, height;
+    chtype glyph; // Blank once the block is destroyed
+};
+
+// Block storage. Blocks never move, so instead of one heap object per block the
+// store keeps every field in packed parallel arrays carved out of a single
+// allocation, with standing blocks tracked in a bitmask.
+//
+// Every add and hit is also appended to a change log that whoever draws the
+// blocks works through at its own pace. The log is reserved for the most
+// changes the blocks can make, so it never moves: a render thread can read
+// the entries before a count the simulation thread published while more are
+// appended behind it.
+class BlockStore {
+public:
+    static const int kMaxHitPoints = 3;
+
 private:
-    int hitPoints;
-    int score;
-    int colorPair;
+    std::vector<uint64_t> storage; // Backs every array below
+    int count;
+    int activeCount;
+    uint64_t* activeBits;  // Bit i set while block i is standing
+    uint64_t* powerUpBits; // Bit i set when block i releases a multi-ball
+    int16_t* xs;
+    int16_t* ys;
+    int16_t* scores;
+    uint8_t* widths;
+    uint8_t* heights;
+    int8_t* hitPoints;
+    uint8_t* colorPairs;
+    std::vector<BlockChange> changes; // Room for every add and every hit, see reset()
+
+    void logChange(int i) {
+        changes.push_back(BlockChange{xs[i], ys[i], widths[i], heights[i], glyph(i)});
+    }
 
 public:
-    Block(float x, float y, float width, float height, int hitPoints = 1, int score = 100, int colorPair = 3)
-        : GameObject(x, y, width, height), hitPoints(hitPoints), score(score), colorPair(colorPair) {}
+    BlockStore() : count(0), activeCount(0), activeBits(nullptr), powerUpBits(nullptr),
+                   xs(nullptr), ys(nullptr), scores(nullptr), widths(nullptr), heights(nullptr), hitPoints(nullptr), colorPairs(nullptr) {}
+
+    // The arrays point into storage, so a copy would alias the original
+    BlockStore(const BlockStore&) = delete;
+    BlockStore& operator=(const BlockStore&) = delete;
+
+    // Drops every block and lays out room for maxBlocks in one allocation.
+    // The change log gets its own, sized for each block being added and then
+    // hit kMaxHitPoints times.
+    void reset(int maxBlocks) {
+        size_t n = static_cast<size_t>(maxBlocks);
+        size_t words = (n + 63) / 64;
+        size_t bytes = 2 * words * sizeof(uint64_t) + 3 * n * sizeof(int16_t) + 4 * n;
+        storage.assign((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+
+        activeBits = storage.data();
+        powerUpBits = activeBits + words;
+        unsigned char* next = reinterpret_cast<unsigned char*>(powerUpBits + words);
+        xs = reinterpret_cast<int16_t*>(next);     next += n * sizeof(int16_t);
+        ys = reinterpret_cast<int16_t*>(next);     next += n * sizeof(int16_t);
+        scores = reinterpret_cast<int16_t*>(next); next += n * sizeof(int16_t);
+        widths = next;                             next += n;
+        heights = next;                            next += n;
+        hitPoints = reinterpret_cast<int8_t*>(next); next += n;
+        colorPairs = next;
+
+        changes.clear();
+        changes.shrink_to_fit();
+        changes.reserve(n * (1 + kMaxHitPoints));
+
+        count = 0;
+        activeCount = 0;
+    }
 
-    void update(float deltaTime) override {}
+    // Returns the new block's index; reset() must have reserved room for it.
+    // Hit points are capped at kMaxHitPoints.
+    int add(int x, int y, int width, int height, int hp, int score, int colorPair, bool powerUp = false) {
+        int i = count++;
+        xs[i] = static_cast<int16_t>(x);
+        ys[i] = static_cast<int16_t>(y);
+        widths[i] = static_cast<uint8_t>(width);
+        heights[i] = static_cast<uint8_t>(height);
+        hitPoints[i] = static_cast<int8_t>(std::min(hp, kMaxHitPoints));
+        scores[i] = static_cast<int16_t>(score);
+        colorPairs[i] = static_cast<uint8_t>(colorPair);
+        activeBits[i / 64] |= uint64_t(1) << (i % 64);
+        if (powerUp) powerUpBits[i / 64] |= uint64_t(1) << (i % 64);
+        activeCount++;
+        logChange(i);
+        return i;
+    }
 
-    void draw() override {
-        if (!active) return;
+    int size() const { return count; }
+    int getActiveCount() const { return activeCount; }
+    bool isActive(int i) const { return (activeBits[i / 64] >> (i % 64)) & 1; }
+    bool isPowerUp(int i) const { return (powerUpBits[i / 64] >> (i % 64)) & 1; }
+
+    int getX(int i) const { return xs[i]; }
+    int getY(int i) const { return ys[i]; }
+    int getWidth(int i) const { return widths[i]; }
+    int getHeight(int i) const { return heights[i]; }
+    int getScore(int i) const { return scores[i]; }
+
+    // How block i looks now: its colour while standing, blank once destroyed
+    chtype glyph(int i) const {
+        if (!isActive(i)) return ' ';
+        return (isPowerUp(i) ? ACS_DIAMOND : ACS_CKBOARD) | COLOR_PAIR(colorPairs[i]);
+    }
 
-        int currentX = static_cast<int>(round(position.x));
-        int currentY = static_cast<int>(round(position.y));
+    // Every add and hit so far, in order
+    const BlockChange* getChanges() const { return changes.data(); }
+    size_t getChangeCount() const { return changes.size(); }
 
-        attron(COLOR_PAIR(colorPair));
-        for (int y = 0; y < static_cast<int>(size.y); y++) {
-            for (int x = 0; x < static_cast<int>(size.x); x++) {
-                mvaddch(currentY + y, currentX + x, ACS_CKBOARD);
-            }
-        }
-        attroff(COLOR_PAIR(colorPair));
+    // Sweeps a rectangle at pos moving by move against block i
+    bool sweep(int i, const Vector2D& pos, const Vector2D& move, const Vector2D& size, float maxTime,
+               SweepHit& hit) const {
+        return sweepBox(pos.x, pos.y, move.x, move.y, xs[i] - size.x, ys[i] - size.y,
+                        xs[i] + widths[i], ys[i] + heights[i], maxTime, hit);
     }
 
-    bool hit() {
-        hitPoints--;
-        if (hitPoints <= 0) {
-            active = false;
-            clearPrevious();
-            return true;
+    // Returns true when the hit destroys the block, which must be standing
+    bool hit(int i) {
+        hitPoints[i]--;
+        bool destroyed = hitPoints[i] <= 0;
+        if (destroyed) {
+            activeBits[i / 64] &= ~(uint64_t(1) << (i % 64));
+            activeCount--;
+        } else {
+            colorPairs[i] = static_cast<uint8_t>(3 + (3 - hitPoints[i]));
         }
-        colorPair = 3 + (3 - hitPoints);
-        return false;
+        logChange(i);
+        return destroyed;
     }
-
-    int getScore() const { return score; }
 };
 
 // BattleBox class
@@ -193,21 +301,20 @@ public:
     BattleBox(int startX, int startY, int w, int h)
         : x(startX), y(startY), width(w), height(h), needsRedraw(true) {}
 
-    void draw() {
+    void draw(Renderer& out) {
         if (!needsRedraw) return;
 
-        attron(A_REVERSE);
+        chtype border = ' ' | A_REVERSE;
         for (int i = -1; i <= width + 1; i++) {
-            mvaddch(y, x + i, ' ');
-            mvaddch(y + height, x + i, ' ');
+            out.putChar(y, x + i, border);
+            out.putChar(y + height, x + i, border);
         }
         for (int i = 0; i <= height; i++) {
-            mvaddch(y + i, x, ' ');
-            mvaddch(y + i, x + width, ' ');
-            mvaddch(y + i, x - 1, ' ');
-            mvaddch(y + i, x + 1 + width, ' ');
+            out.putChar(y + i, x, border);
+            out.putChar(y + i, x + width, border);
+            out.putChar(y + i, x - 1, border);
+            out.putChar(y + i, x + 1 + width, border);
         }
-        attroff(A_REVERSE);
         needsRedraw = false;
     }
 
@@ -219,55 +326,198 @@ public:
     int getHeight() const { return height; }
 };
 
-// Game class
-class BreakoutGame {
-private:
-    BattleBox* gameArea;
-    Ball* ball;
-    Paddle* paddle;
-    std::vector<Block*> blocks;
+// Everything needed to draw one moment of the game, copied out of the
+// simulation so it can be drawn on another thread while the game moves on.
+// Sprites carry their positions from the start and the end of the last step
+// for the drawing side to interpolate between.
+struct GameSnapshot {
+    struct Sprite {
+        Vector2D previous, position;
+    };
+
+    std::chrono::steady_clock::time_point time; // Threaded mode: wall-clock time the positions are for
+    Sprite paddle;
+    Vector2D paddleSize;
+    std::vector<Sprite> balls;
+    const BlockChange* blockChanges; // The game's block change log, and how much of it has happened
+    size_t blockChangeCount;
     int score;
     int blockHits;
     int minBlockHits;
     float timeRemaining;
     bool gameOver;
     bool win;
+
+    GameSnapshot()
+        : blockChanges(nullptr), blockChangeCount(0), score(0), blockHits(0), minBlockHits(0),
+          timeRemaining(0), gameOver(false), win(false) {}
+};
+
+// Draws snapshots of one game. Everything about what is already on screen
+// lives here rather than in the game: the static layer holding the border and
+// blocks, how far through the block change log it is, and where the sprites
+// were drawn last frame. Each frame only sends the cells that changed.
+class BreakoutView {
+private:
+    struct Cell {
+        int y, x;
+    };
+
+    BattleBox box;
+    StaticLayer background;      // Border and blocks, flushed to the output only where they change
+    int layerX, layerY;          // Screen position of the layer's first cell
+    int layerWidth, layerHeight;
     int statusLine;
+    size_t blockChangesDrawn;    // Block change log entries already in background
+    bool paddleDrawn;
+    int paddleX, paddleY;        // Where the paddle was drawn last frame
+    std::vector<Cell> ballCells; // Where balls were drawn last frame
+    std::vector<Cell> nextBallCells;
+    std::vector<unsigned> covered; // Per layer cell: the last frame a ball was drawn there
+    unsigned frame;
+
+    int layerIndex(int y, int x) const {
+        x -= layerX;
+        y -= layerY;
+        if (x < 0 || y < 0 || x >= layerWidth || y >= layerHeight) return -1;
+        return y * layerWidth + x;
+    }
+
+    static int cellOf(float position) { return static_cast<int>(round(position)); }
 
 public:
-    BreakoutGame(int startX, int startY, int width, int height, float timeLimit, int minBlockHits)
-        : score(0), blockHits(0), minBlockHits(minBlockHits), timeRemaining(timeLimit),
-          gameOver(false), win(false) {
-        
-        srand(static_cast<unsigned int>(time(nullptr)));
+    BreakoutView(int startX, int startY, int width, int height)
+        : box(startX, startY, width, height), background(startX - 1, startY, width + 3, height + 1),
+          layerX(startX - 1), layerY(startY), layerWidth(width + 3), layerHeight(height + 1),
+          statusLine(startY + height + 2), blockChangesDrawn(0), paddleDrawn(false), paddleX(0), paddleY(0),
+          covered(static_cast<size_t>(width + 3) * (height + 1), 0), frame(0) {}
+
+    // alpha is how far the clock is between the snapshot's two positions (0..1)
+    void render(const GameSnapshot& state, Renderer& out, float alpha) {
+        box.draw(background);
+        for (; blockChangesDrawn < state.blockChangeCount; blockChangesDrawn++) {
+            const BlockChange& change = state.blockChanges[blockChangesDrawn];
+            for (int y = 0; y < change.height; y++) {
+                for (int x = 0; x < change.width; x++) {
+                    background.putChar(change.y + y, change.x + x, change.glyph);
+                }
+            }
+        }
+        background.flush(out);
+
+        // The paddle leaves its old cells only when it has moved to new ones
+        Vector2D paddlePos = Vector2D::lerp(state.paddle.previous, state.paddle.position, alpha);
+        int paddleWidth = static_cast<int>(state.paddleSize.x);
+        int paddleHeight = static_cast<int>(state.paddleSize.y);
+        int currentX = cellOf(paddlePos.x);
+        int currentY = cellOf(paddlePos.y);
+        if (paddleDrawn && (currentX != paddleX || currentY != paddleY)) {
+            for (int y = 0; y < paddleHeight; y++) {
+                for (int x = 0; x < paddleWidth; x++) {
+                    background.restore(out, paddleY + y, paddleX + x);
+                }
+            }
+        }
+        paddleX = currentX;
+        paddleY = currentY;
+        paddleDrawn = true;
+        for (int y = 0; y < paddleHeight; y++) {
+            for (int x = 0; x < paddleWidth; x++) {
+                out.putChar(paddleY + y, paddleX + x, ACS_BLOCK | COLOR_PAIR(2));
+            }
+        }
 
-        gameArea = new BattleBox(startX, startY, width, height);
-        statusLine = startY + height + 2;
+        // Cells a ball sat on last frame and none does now get their static
+        // content back; a ball that was lost or merely moved is the same case
+        frame++;
+        nextBallCells.clear();
+        if (nextBallCells.capacity() < state.balls.capacity()) {
+            nextBallCells.reserve(state.balls.capacity());
+            ballCells.reserve(state.balls.capacity());
+        }
+        for (const GameSnapshot::Sprite& ball : state.balls) {
+            Vector2D pos = Vector2D::lerp(ball.previous, ball.position, alpha);
+            Cell cell = {cellOf(pos.y), cellOf(pos.x)};
+            int i = layerIndex(cell.y, cell.x);
+            if (i >= 0) covered[i] = frame;
+            nextBallCells.push_back(cell);
+        }
+        for (const Cell& cell : ballCells) {
+            int i = layerIndex(cell.y, cell.x);
+            if (i < 0 || covered[i] != frame) background.restore(out, cell.y, cell.x);
+        }
+        for (const Cell& cell : nextBallCells) {
+            out.putChar(cell.y, cell.x, ACS_BULLET | COLOR_PAIR(1));
+        }
+        ballCells.swap(nextBallCells);
 
-        ball = new Ball(startX + width / 2, startY + height / 2, 1.0f, 20.0f);
-        paddle = new Paddle(startX + (width - 10.0f) / 2, startY + height - 2.0f, 10.0f, 1.0f, 30.0f);
-        setupBlocks(startX, startY);
-    }
+        out.print(statusLine, box.getX(), "Score: %d | Blocks: %d/%d | Balls: %zu | Time: %.1fs ",
+                  state.score, state.blockHits, state.minBlockHits, state.balls.size(), state.timeRemaining);
 
-    ~BreakoutGame() {
-        delete gameArea;
-        delete ball;
-        delete paddle;
-        for (auto block : blocks) {
-            delete block;
+        if (state.gameOver) {
+            out.printAttr(box.getY() + box.getHeight() / 2, box.getX() + box.getWidth() / 2 - 5, A_BOLD,
+                          state.win ? "YOU WIN!" : "GAME OVER!");
         }
-        blocks.clear();
     }
+};
 
-    void setupBlocks(int startX, int startY) {
-        float blockWidth = 5.0f;
-        float blockHeight = 2.0f;
+// What a ball runs into, in the order ties between equal-time contacts are broken
+enum ImpactTarget { HIT_NONE, HIT_WALL, HIT_FLOOR, HIT_PADDLE, HIT_BLOCK };
+
+// Game class
+class BreakoutGame {
+public:
+    static constexpr float kBlockWidth = 5.0f;
+    static constexpr float kBlockHeight = 2.0f;
+    static constexpr float kBlockSpacing = 1.0f;
+
+private:
+    RandomSource random;
+    BattleBox gameArea;
+    BreakoutView view;        // Draws the game for render()
+    GameSnapshot renderState; // What render() last handed the view
+    std::vector<Ball> balls;
+    Paddle paddle;
+    BlockStore blocks;
+    SpatialGrid blockGrid; // Active blocks by cell, one cell per block slot
+    SortAndSweep ballPairs; // Ball-ball broadphase, sorted order kept between steps
+    ThreadPool* pool;      // Spreads ball updates over threads when set
+    int powerUps;          // Blocks that release balls, each adding two
+    int score;
+    int blockHits;
+    int minBlockHits;
+    float timeRemaining;
+    bool gameOver;
+    bool win;
+
+    long long stepsRun; // Steps taken by update() and advance()
+
+    // Event-driven mode (advance())
+    long long ballSteps;  // Steps taken by a ball, one per ball per step
+    long long ballSweeps; // The ones that went through stepBall()
+
+public:
+    BreakoutGame(int startX, int startY, int width, int height, float timeLimit, int minBlockHits,
+                 unsigned int seed = static_cast<unsigned int>(time(nullptr)), int blockRows = 5)
+        : random(seed), gameArea(startX, startY, width, height), view(startX, startY, width, height),
+          paddle(startX + (width - 10.0f) / 2, startY + height - 2.0f, 10.0f, 1.0f, 30.0f),
+          blockGrid(startX, startY, width, height, kBlockWidth + kBlockSpacing, kBlockHeight + kBlockSpacing),
+          pool(nullptr), powerUps(0), score(0), blockHits(0), minBlockHits(minBlockHits), timeRemaining(timeLimit),
+          gameOver(false), win(false), stepsRun(0), ballSteps(0), ballSweeps(0) {
+        balls.push_back(Ball(startX + width / 2, startY + height / 2, 1.0f, 20.0f, random));
+        setupBlocks(startX, startY, blockRows);
+        reserveBalls();
+    }
+
+    void setupBlocks(int startX, int startY, int rows) {
+        float blockWidth = kBlockWidth;
+        float blockHeight = kBlockHeight;
         float startBlockX = startX + 2.0f;
         float startBlockY = startY + 3.0f;
-        float spacing = 1.0f;
+        float spacing = kBlockSpacing;
 
-        int rows = 5;
-        int cols = static_cast<int>((gameArea->getWidth() - 4 + spacing) / (blockWidth + spacing));
+        int cols = static_cast<int>((gameArea.getWidth() - 4 + spacing) / (blockWidth + spacing));
+        blocks.reset(rows * cols);
 
         for (int row = 0; row < rows; row++) {
             for (int col = 0; col < cols; col++) {
@@ -276,23 +526,60 @@ public:
                 int hitPoints = std::min(3, rows - row);
                 int blockScore = hitPoints * 50;
                 int colorPair = 3 + (3 - hitPoints);
-                blocks.push_back(new Block(x, y, blockWidth, blockHeight, hitPoints, blockScore, colorPair));
+                bool powerUp = random.nextInt(8) == 0;
+                if (powerUp) powerUps++;
+                int id = blocks.add(static_cast<int>(x), static_cast<int>(y), static_cast<int>(blockWidth),
+                                    static_cast<int>(blockHeight), hitPoints, blockScore, colorPair, powerUp);
+                blockGrid.insert(id, x, y, blockWidth, blockHeight);
             }
         }
     }
 
+    // Stress mode: launches extra balls on random courses from random points
+    // between the first ball's start and the paddle, in sixteenths of a cell
+    void addBalls(int count) {
+        int spanX = std::max(1, (gameArea.getWidth() - 3) * 16);
+        int spanY = std::max(1, (gameArea.getHeight() / 2 - 3) * 16);
+        for (int i = 0; i < count; i++) {
+            float x = gameArea.getX() + 1 + random.nextInt(spanX) / 16.0f;
+            float y = gameArea.getY() + gameArea.getHeight() / 2 + random.nextInt(spanY) / 16.0f;
+            balls.push_back(Ball(x, y, 1.0f, 20.0f, random));
+        }
+        reserveBalls();
+    }
+
+    // Sizes everything that grows with the ball count for the most balls the
+    // board can release, so power-ups never allocate mid-game
+    void reserveBalls() {
+        int most = static_cast<int>(balls.size()) + 2 * powerUps;
+        balls.reserve(most);
+        ballPairs.reserve(most);
+        renderState.balls.reserve(most);
+    }
+
+    // Null runs every ball on the calling thread
+    void setThreadPool(ThreadPool* threads) { pool = threads; }
+
     void handleInput(int key, float deltaTime) {
         if (gameOver) return;
 
         if (key == KEY_LEFT) {
-            paddle->moveLeft(deltaTime, gameArea->getX() + 1);
+            paddle.moveLeft(deltaTime, gameArea.getX() + 1);
         } else if (key == KEY_RIGHT) {
-            paddle->moveRight(deltaTime, gameArea->getX() + gameArea->getWidth() - 1);
+            paddle.moveRight(deltaTime, gameArea.getX() + gameArea.getWidth() - 1);
         }
     }
 
+    // Advances the game by one step; the main loop always passes kSimStep
     void update(float deltaTime) {
         if (gameOver) return;
+        runStep(deltaTime, false);
+    }
+
+    // One step for update() and advance(). With predicted set, balls whose
+    // wake step has not come only fly; every other ball is swept.
+    void runStep(float deltaTime, bool predicted) {
+        paddle.storePrevious();
 
         timeRemaining -= deltaTime;
         if (timeRemaining <= 0) {
@@ -300,105 +587,338 @@ public:
             checkGameOver();
         }
 
-        ball->update(deltaTime);
-
-        Vector2D ballPos = ball->getPosition();
-        Vector2D ballSize = ball->getSize();
-        Vector2D ballVel = ball->getVelocity();
-
-        if (ballPos.x <= gameArea->getX() + 1 || 
-            ballPos.x + ballSize.x >= gameArea->getX() + gameArea->getWidth() - 1) {
-            ball->bounceX();
-        }
-
-        if (ballPos.y <= gameArea->getY() + 1) {
-            ball->bounceY();
+        // Parallel phase: every ball moves and bounces on its own, treating the
+        // blocks as solid and read-only and noting the ones it hits
+        int count = static_cast<int>(balls.size());
+        auto stepRange = [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                if (predicted && balls[i].getWakeStep() > stepsRun) {
+                    flyBall(balls[i], deltaTime);
+                } else {
+                    stepBall(balls[i], deltaTime);
+                }
+            }
+        };
+        if (pool && count >= kParallelMinBalls) {
+            pool->parallelFor(count, stepRange);
+        } else {
+            stepRange(0, count);
         }
 
-        if (ballPos.y + ballSize.y >= gameArea->getY() + gameArea->getHeight() - 1) {
-            gameOver = true;
-            win = false;
-            return;
+        // Serial phase: the hits are applied in ball order, so the outcome does
+        // not depend on how the balls were split between threads
+        for (int i = 0; i < count && !gameOver; i++) {
+            for (int h = 0; h < balls[i].getHitCount() && !gameOver; h++) {
+                hitBlock(i, balls[i].getHit(h));
+            }
         }
 
-        if (ball->collidesWith(*paddle)) {
-            if (ballVel.y > 0) {
-                ball->bounceY();
-                float hitPoint = (ballPos.x + ballSize.x / 2) - paddle->getPosition().x;
-                float paddleWidth = paddle->getSize().x;
-                float normalizedHitPoint = (hitPoint / paddleWidth) * 2 - 1;
+        removeLostBalls();
+        collideBalls();
+        stepsRun++;
+    }
 
-                Vector2D vel = ball->getVelocity();
-                float speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
-                float angle = normalizedHitPoint * 0.5f;
+    // Sweeps one ball through the step: find the first surface it would touch,
+    // move it exactly there, bounce, and carry on with the time that is left. It
+    // cannot skip anything however far it travels in one step. Only touches the
+    // ball itself, so balls can be stepped in parallel.
+    void stepBall(Ball& ball, float deltaTime) const {
+        ball.storePrevious();
+        ball.clearHits();
+        ball.setWakeStep(0); // Wherever it ends up, advance() predicts afresh
+
+        float timeLeft = deltaTime;
+        for (int bounce = 0; bounce < kMaxBouncesPerStep && timeLeft > 0; bounce++) {
+            Vector2D ballPos = ball.getPosition();
+            Vector2D ballSize = ball.getSize();
+            Vector2D move = ball.getVelocity() * timeLeft;
+
+            ImpactTarget target = HIT_NONE;
+            SweepHit hit = {1.0f, false};
+            SweepHit candidate;
+
+            float timeX = sweepBounds(ballPos.x, move.x, gameArea.getX() + 1,
+                                      gameArea.getX() + gameArea.getWidth() - 1 - ballSize.x);
+            float timeY = sweepBounds(ballPos.y, move.y, gameArea.getY() + 1,
+                                      gameArea.getY() + gameArea.getHeight() - 1 - ballSize.y);
+            if (timeX < hit.time) {
+                hit = {timeX, true};
+                target = HIT_WALL;
+            }
+            if (timeY < hit.time) {
+                hit = {timeY, false};
+                target = move.y > 0 ? HIT_FLOOR : HIT_WALL;
+            }
 
-                Vector2D newVel;
-                newVel.x = speed * angle;
-                newVel.y = -std::sqrt(speed * speed - newVel.x * newVel.x);
+            Vector2D paddlePos = paddle.getPosition();
+            Vector2D paddleSize = paddle.getSize();
+            if (move.y > 0 && sweepBox(ballPos.x, ballPos.y, move.x, move.y, paddlePos.x - ballSize.x,
+                                       paddlePos.y - ballSize.y, paddlePos.x + paddleSize.x,
+                                       paddlePos.y + paddleSize.y, hit.time, candidate)) {
+                hit = candidate;
+                target = HIT_PADDLE;
+            }
 
-                if (std::abs(newVel.x) < 5.0f) {
-                    newVel.x = newVel.x > 0 ? 5.0f : -5.0f;
-                    newVel.y = -std::sqrt(speed * speed - newVel.x * newVel.x);
+            // Only blocks in the cells the move passes over are candidates. The lowest
+            // index wins a tie so the result does not depend on the order of the cells.
+            int hitIndex = -1;
+            blockGrid.query(std::min(ballPos.x, ballPos.x + move.x), std::min(ballPos.y, ballPos.y + move.y),
+                            std::abs(move.x) + ballSize.x, std::abs(move.y) + ballSize.y, [&](int id) {
+                if (!blocks.isActive(id) || !blocks.sweep(id, ballPos, move, ballSize, 1.0f, candidate)) return;
+                if (candidate.time < hit.time || (target == HIT_BLOCK && candidate.time == hit.time && id < hitIndex)) {
+                    hit = candidate;
+                    target = HIT_BLOCK;
+                    hitIndex = id;
                 }
+            });
+
+            ball.update(timeLeft * hit.time);
+            timeLeft -= timeLeft * hit.time;
+
+            if (target == HIT_NONE) break;
+
+            bounceBall(ball, target, hit.reflectX);
+            if (target == HIT_BLOCK) ball.addHit(hitIndex);
+            if (!ball.isActive()) return;
+        }
+    }
+
+    // Event-driven alternative to calling update(kSimStep) steps times, with
+    // exactly the same outcome: the same steps run, with the same arithmetic.
+    // What it skips are collision tests. Once a ball has been swept, its
+    // course is checked for the first thing it could touch, and until the step
+    // before that it only flies, which is all stepBall() would have done with
+    // it. From then on it is swept again, as it is straight away when another
+    // ball knocks it or update() has moved it. Returns the steps taken, fewer
+    // when the game ends first.
+    int advance(int steps) {
+        int taken = 0;
+        for (; taken < steps && !gameOver; taken++) {
+            for (const Ball& ball : balls) {
+                if (ball.getWakeStep() <= stepsRun) ballSweeps++;
+            }
+            ballSteps += static_cast<long long>(balls.size());
+
+            runStep(kSimStep, true);
 
-                ball->setVelocity(newVel);
+            for (Ball& ball : balls) {
+                if (ball.getWakeStep() < stepsRun) ball.setWakeStep(stepsRun + quietSteps(ball));
             }
         }
+        return taken;
+    }
 
-        for (auto block : blocks) {
-            if (block->isActive() && ball->collidesWith(*block)) {
-                Vector2D blockPos = block->getPosition();
-                Vector2D blockSize = block->getSize();
-                bool hitVertical = (ballPos.x + ballSize.x / 2 >= blockPos.x && 
-                                    ballPos.x + ballSize.x / 2 <= blockPos.x + blockSize.x);
+    // A step of stepBall() that meets nothing: the ball moves the whole step
+    static void flyBall(Ball& ball, float deltaTime) {
+        ball.storePrevious();
+        ball.clearHits();
+        ball.update(deltaTime);
+    }
 
-                if (hitVertical) {
-                    ball->bounceY();
-                } else {
-                    ball->bounceX();
-                }
+    // Whole steps a ball can fly on its present course before stepBall()
+    // could find anything in its way. Everything it could meet is grown by
+    // kWakeMargin, which covers the rounding flight builds up over
+    // kMaxQuietSteps, and the step the contact would fall in is not counted.
+    // The paddle is taken as its whole row, so moving it never spoils a
+    // prediction; blocks only ever go away, which at worst wakes a ball early.
+    int quietSteps(const Ball& ball) const {
+        if (!ball.isActive()) return 0;
+
+        Vector2D pos = ball.getPosition();
+        Vector2D size = ball.getSize();
+        Vector2D velocity = ball.getVelocity();
+        float reach = kMaxQuietSteps * kSimStep; // Seconds
+
+        reach = std::min(reach, sweepBounds(pos.x, velocity.x, gameArea.getX() + 1 + kWakeMargin,
+                                            gameArea.getX() + gameArea.getWidth() - 1 - size.x - kWakeMargin));
+        reach = std::min(reach, sweepBounds(pos.y, velocity.y, gameArea.getY() + 1 + kWakeMargin,
+                                            gameArea.getY() + gameArea.getHeight() - 1 - size.y - kWakeMargin));
+
+        float paddleTop = paddle.getPosition().y - size.y - kWakeMargin;
+        float paddleBottom = paddle.getPosition().y + paddle.getSize().y + kWakeMargin;
+        if (velocity.y > 0 && pos.y < paddleBottom) {
+            reach = std::min(reach, std::max(0.0f, (paddleTop - pos.y) / velocity.y));
+        }
 
-                if (block->hit()) {
-                    score += block->getScore();
-                    blockHits++;
+        if (reach > 0) {
+            Vector2D move = velocity * reach;
+            blockGrid.query(std::min(pos.x, pos.x + move.x) - kWakeMargin, std::min(pos.y, pos.y + move.y) - kWakeMargin,
+                            std::abs(move.x) + size.x + 2 * kWakeMargin, std::abs(move.y) + size.y + 2 * kWakeMargin,
+                            [&](int id) {
+                if (!blocks.isActive(id)) return;
+                float left = blocks.getX(id) - size.x - kWakeMargin;
+                float top = blocks.getY(id) - size.y - kWakeMargin;
+                float right = blocks.getX(id) + blocks.getWidth(id) + kWakeMargin;
+                float bottom = blocks.getY(id) + blocks.getHeight(id) + kWakeMargin;
+                // Already inside the margin: a sweep only counts entering
+                if (pos.x > left && pos.x < right && pos.y > top && pos.y < bottom) {
+                    reach = 0;
+                    return;
                 }
-                break;
-            }
+                SweepHit hit;
+                if (sweepBox(pos.x, pos.y, velocity.x, velocity.y, left, top, right, bottom, reach, hit)) {
+                    reach = hit.time;
+                }
+            });
         }
 
-        bool allBlocksDestroyed = true;
-        for (auto block : blocks) {
-            if (block->isActive()) {
-                allBlocksDestroyed = false;
-                break;
-            }
+        return std::max(0, static_cast<int>(reach / kSimStep) - 1);
+    }
+
+    // Bounces a ball off the contact it has just been moved onto. Reaching the
+    // floor loses the ball instead.
+    void bounceBall(Ball& ball, ImpactTarget target, bool reflectX) const {
+        if (target == HIT_FLOOR) {
+            ball.setActive(false);
+            return;
         }
 
-        if (allBlocksDestroyed || blockHits >= minBlockHits) {
+        if (reflectX) {
+            ball.bounceX();
+        } else if (target == HIT_PADDLE) {
+            bounceOffPaddle(ball);
+        } else {
+            ball.bounceY();
+        }
+    }
+
+    // Damages a block a ball bounced off. Another ball may have destroyed it
+    // earlier in the same step, in which case nothing happens.
+    void hitBlock(int ballIndex, int blockIndex) {
+        if (!blocks.isActive(blockIndex) || !blocks.hit(blockIndex)) return;
+
+        score += blocks.getScore(blockIndex);
+        blockHits++;
+        blockGrid.remove(blockIndex, blocks.getX(blockIndex), blocks.getY(blockIndex),
+                         blocks.getWidth(blockIndex), blocks.getHeight(blockIndex));
+
+        // Multi-ball: the ball that broke the block carries on and two more fan out from it
+        if (blocks.isPowerUp(blockIndex) && balls[ballIndex].isActive()) {
+            Ball left = balls[ballIndex].split(-kSplitAngle);
+            Ball right = balls[ballIndex].split(kSplitAngle);
+            balls.push_back(left);
+            balls.push_back(right);
+        }
+
+        if (blocks.getActiveCount() == 0 || blockHits >= minBlockHits) {
             gameOver = true;
             win = true;
         }
     }
 
-    void render() {
-        gameArea->draw();
-        for (auto block : blocks) {
-            if (block->isActive()) {
-                block->draw();
-            }
+    // Elastic ball-ball collisions, found by sort-and-sweep so thousands of
+    // balls do not mean millions of pair tests
+    void collideBalls() {
+        ballPairs.findPairs(static_cast<int>(balls.size()),
+            [&](int id, float& minX, float& minY, float& maxX, float& maxY) {
+                Vector2D pos = balls[id].getPosition();
+                Vector2D size = balls[id].getSize();
+                minX = pos.x;
+                minY = pos.y;
+                maxX = pos.x + size.x;
+                maxY = pos.y + size.y;
+            },
+            [&](int a, int b) {
+                // A knocked ball's course has changed under its prediction
+                if (bounceBalls(balls[a], balls[b])) {
+                    balls[a].setWakeStep(0);
+                    balls[b].setWakeStep(0);
+                }
+            });
+    }
+
+    // Balls are equal-mass discs as wide as their cell. Two that overlap and
+    // are closing swap their velocity components along the line between
+    // their centres; ones already moving apart are left alone. Returns true
+    // when they bounced.
+    static bool bounceBalls(Ball& a, Ball& b) {
+        Vector2D posA = a.getPosition();
+        Vector2D posB = b.getPosition();
+        float dx = posA.x - posB.x;
+        float dy = posA.y - posB.y;
+        float distance = std::sqrt(dx * dx + dy * dy);
+        if (distance <= 0.0f || distance >= a.getSize().x) return false;
+
+        float nx = dx / distance;
+        float ny = dy / distance;
+        Vector2D velA = a.getVelocity();
+        Vector2D velB = b.getVelocity();
+        float closing = (velA.x - velB.x) * nx + (velA.y - velB.y) * ny;
+        if (closing >= 0.0f) return false;
+
+        a.setVelocity(Vector2D(velA.x - closing * nx, velA.y - closing * ny));
+        b.setVelocity(Vector2D(velB.x + closing * nx, velB.y + closing * ny));
+        return true;
+    }
+
+    // Drops the balls that fell out, keeping the rest in order. Losing the
+    // last one ends the game.
+    void removeLostBalls() {
+        size_t kept = 0;
+        for (size_t i = 0; i < balls.size(); i++) {
+            if (!balls[i].isActive()) continue;
+            if (kept != i) balls[kept] = balls[i];
+            kept++;
         }
-        paddle->draw();
-        ball->draw();
+        balls.erase(balls.begin() + kept, balls.end());
 
-        mvprintw(statusLine, gameArea->getX(), "Score: %d | Blocks: %d/%d | Time: %.1fs", 
-                 score, blockHits, minBlockHits, timeRemaining);
+        if (balls.empty() && !gameOver) {
+            gameOver = true;
+            win = false;
+        }
+    }
 
-        if (gameOver) {
-            attron(A_BOLD);
-            mvprintw(gameArea->getY() + gameArea->getHeight() / 2, 
-                     gameArea->getX() + gameArea->getWidth() / 2 - 5, win ? "YOU WIN!" : "GAME OVER!");
-            attroff(A_BOLD);
+    // Sends a ball back up at an angle set by where it met the paddle
+    void bounceOffPaddle(Ball& ball) const {
+        Vector2D ballPos = ball.getPosition();
+        Vector2D ballSize = ball.getSize();
+        ball.bounceY();
+        float hitPoint = (ballPos.x + ballSize.x / 2) - paddle.getPosition().x;
+        float paddleWidth = paddle.getSize().x;
+        float normalizedHitPoint = (hitPoint / paddleWidth) * 2 - 1;
+
+        Vector2D vel = ball.getVelocity();
+        float speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
+        float angle = normalizedHitPoint * 0.5f;
+
+        Vector2D newVel;
+        newVel.x = speed * angle;
+        newVel.y = -std::sqrt(speed * speed - newVel.x * newVel.x);
+
+        if (std::abs(newVel.x) < 5.0f) {
+            newVel.x = newVel.x > 0 ? 5.0f : -5.0f;
+            newVel.y = -std::sqrt(speed * speed - newVel.x * newVel.x);
         }
+
+        ball.setVelocity(newVel);
+    }
+
+    // Copies out what a view needs to draw the game as it stands. The
+    // snapshot's storage is reused and sized on first use for as many balls
+    // as the game can have, so after that this allocates nothing.
+    void snapshot(GameSnapshot& out) const {
+        out.paddle = GameSnapshot::Sprite{paddle.getPreviousPosition(), paddle.getPosition()};
+        out.paddleSize = paddle.getSize();
+        out.balls.reserve(balls.capacity());
+        out.balls.resize(balls.size());
+        for (size_t i = 0; i < balls.size(); i++) {
+            out.balls[i] = GameSnapshot::Sprite{balls[i].getPreviousPosition(), balls[i].getPosition()};
+        }
+        out.blockChanges = blocks.getChanges();
+        out.blockChangeCount = blocks.getChangeCount();
+        out.score = score;
+        out.blockHits = blockHits;
+        out.minBlockHits = minBlockHits;
+        out.timeRemaining = timeRemaining;
+        out.gameOver = gameOver;
+        out.win = win;
+    }
+
+    // Draws the game on the calling thread, through its own view. alpha is
+    // how far the clock is between the last two steps (0..1).
+    void render(Renderer& out, float alpha) {
+        snapshot(renderState);
+        view.render(renderState, out, alpha);
     }
 
     void checkGameOver() {
@@ -413,9 +933,528 @@ public:
 
     bool isGameOver() const { return gameOver; }
     bool isWin() const { return win; }
+    int getScore() const { return score; }
+    int getBlockHits() const { return blockHits; }
+    long long getBallSteps() const { return ballSteps; }
+    long long getBallSweeps() const { return ballSweeps; }
+    float getTimeRemaining() const { return timeRemaining; }
+    const std::vector<Ball>& getBalls() const { return balls; }
+
+    // Fingerprint of the simulation state, for checking that replays match
+    uint64_t stateHash() const {
+        uint64_t h = hashBytes(nullptr, 0);
+        for (const Ball& ball : balls) {
+            Vector2D ballPos = ball.getPosition();
+            Vector2D ballVel = ball.getVelocity();
+            h = hashBytes(&ballPos, sizeof(ballPos), h);
+            h = hashBytes(&ballVel, sizeof(ballVel), h);
+        }
+        Vector2D paddlePos = paddle.getPosition();
+        h = hashBytes(&paddlePos, sizeof(paddlePos), h);
+        h = hashBytes(&score, sizeof(score), h);
+        h = hashBytes(&blockHits, sizeof(blockHits), h);
+        return hashBytes(&timeRemaining, sizeof(timeRemaining), h);
+    }
+    const Paddle& getPaddle() const { return paddle; }
+    const BlockStore& getBlocks() const { return blocks; }
 };
 
-int main() {
+// Headless mode: runs whole games back to back without a terminal or frame pacing.
+// The paddle is steered by a simple autopilot that follows the ball. Frames can
+// optionally be drawn into an off-screen renderer at the interactive 60 Hz rate.
+// In event-driven mode each step goes through advance() instead of update().
+// The autopilot steers every step either way, so both modes play the same
+// games and differ only in how many collision tests they run.
+const int kHeadlessStepsPerFrame = 4;
+
+enum HeadlessRender { RENDER_NONE, RENDER_NULL, RENDER_FRAMEBUFFER };
+
+int autopilotKey(const BreakoutGame& game) {
+    // Follow the falling ball that will reach the paddle first, or failing
+    // that the lowest one
+    const Ball* target = nullptr;
+    float targetTime = INFINITY;
+    float paddleY = game.getPaddle().getPosition().y;
+    for (const Ball& ball : game.getBalls()) {
+        Vector2D pos = ball.getPosition();
+        Vector2D vel = ball.getVelocity();
+        float time = vel.y > 0 ? (paddleY - pos.y) / vel.y : INFINITY;
+        if (!target || time < targetTime || (time == targetTime && pos.y > target->getPosition().y)) {
+            target = &ball;
+            targetTime = time;
+        }
+    }
+    if (!target) return ERR;
+
+    float ballX = target->getPosition().x + target->getSize().x / 2;
+    float paddleX = game.getPaddle().getPosition().x + game.getPaddle().getSize().x / 2;
+
+    if (ballX < paddleX - 1.0f) return KEY_LEFT;
+    if (ballX > paddleX + 1.0f) return KEY_RIGHT;
+    return ERR;
+}
+
+int runHeadless(int games, unsigned int seed, bool verbose, int width, int height, int blockRows,
+                HeadlessRender renderMode, bool eventDriven, int ballCount, ThreadPool* pool) {
+    long long totalSteps = 0;
+    long long totalBallSteps = 0, totalSweeps = 0;
+    long long totalScore = 0;
+    int wins = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < games; i++) {
+        BreakoutGame game(0, 0, width, height, 60.0f, 10, seed + i, blockRows);
+        game.addBalls(ballCount - 1);
+        game.setThreadPool(pool);
+        NullRenderer nullOut(width + 2, height + 3);
+        FramebufferRenderer frameOut(width + 2, height + 3);
+        Renderer* out = renderMode == RENDER_NULL ? static_cast<Renderer*>(&nullOut)
+                      : renderMode == RENDER_FRAMEBUFFER ? static_cast<Renderer*>(&frameOut) : nullptr;
+        int steps = 0;
+
+        while (!game.isGameOver()) {
+            int key = autopilotKey(game);
+            if (key != ERR) {
+                game.handleInput(key, kSimStep);
+            }
+            if (eventDriven) {
+                game.advance(1);
+            } else {
+                game.update(kSimStep);
+            }
+            steps++;
+
+            if (out && steps % kHeadlessStepsPerFrame == 0) {
+                game.render(*out, 1.0f);
+                out->present();
+            }
+        }
+
+        totalSteps += steps;
+        totalScore += game.getScore();
+        totalBallSteps += game.getBallSteps();
+        totalSweeps += game.getBallSweeps();
+        if (game.isWin()) wins++;
+
+        if (verbose) {
+            printf("game %d: %s score=%d blocks=%d steps=%d time=%.2fs state=%016llx",
+                   i, game.isWin() ? "win " : "lose", game.getScore(), game.getBlockHits(),
+                   steps, steps * kSimStep, static_cast<unsigned long long>(game.stateHash()));
+            if (eventDriven) printf(" sweeps=%lld/%lld", game.getBallSweeps(), game.getBallSteps());
+            if (renderMode == RENDER_NULL) printf(" cells=%lld", nullOut.getCellsDrawn());
+            if (renderMode == RENDER_FRAMEBUFFER) printf(" frame=%016llx", (unsigned long long)frameOut.hash());
+            printf("\n");
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds <= 0) seconds = 1e-9;
+
+    printf("games: %d  wins: %d  avg score: %.1f  avg steps: %.1f\n",
+           games, wins, static_cast<double>(totalScore) / games, static_cast<double>(totalSteps) / games);
+    if (eventDriven) {
+        printf("ball steps swept: %lld of %lld (%.1f%%)\n", totalSweeps, totalBallSteps,
+               totalBallSteps > 0 ? 100.0 * totalSweeps / totalBallSteps : 0.0);
+    }
+    printf("wall: %.3fs  games/s: %.1f  updates/s: %.0f  ns/update: %.1f\n",
+           seconds, games / seconds, totalSteps / seconds, seconds * 1e9 / totalSteps);
+    return 0;
+}
+
+// Sets up the colour pairs the draw code uses, if the terminal has colours
+void initColors() {
+    if (has_colors()) {
+        start_color();
+        init_pair(1, COLOR_RED, COLOR_BLACK);
+        init_pair(2, COLOR_WHITE, COLOR_BLUE);
+        init_pair(3, COLOR_BLACK, COLOR_RED);
+        init_pair(4, COLOR_BLACK, COLOR_YELLOW);
+        init_pair(5, COLOR_BLACK, COLOR_GREEN);
+        init_pair(6, COLOR_BLACK, COLOR_CYAN);
+    }
+}
+
+// Benchmark mode: times update and render at scaled block counts. Scale k
+// lays out a board with roughly k times the 45 blocks of the standard one.
+int runBenchmark(unsigned int seed, int frames) {
+    FrameStats::printHeader();
+    int status = 0; // Set when the two sides of a comparison disagree
+
+    for (int scale : kBenchScales) {
+        int width = static_cast<int>(60 * std::sqrt(static_cast<float>(scale)));
+        int cols = static_cast<int>((width - 4 + BreakoutGame::kBlockSpacing) /
+                                    (BreakoutGame::kBlockWidth + BreakoutGame::kBlockSpacing));
+        int rows = (45 * scale + cols - 1) / cols;
+        // Tall enough that the ball and paddle start below the blocks
+        int height = std::max(static_cast<int>(30 * std::sqrt(static_cast<float>(scale))),
+                              2 * (rows * static_cast<int>(BreakoutGame::kBlockHeight + BreakoutGame::kBlockSpacing) + 6));
+        long long blockCount = static_cast<long long>(rows) * cols;
+
+        // Games that end are replaced outside the timed region
+        std::unique_ptr<BreakoutGame> game;
+        auto nextGame = [&](int frame) {
+            if (!game || game->isGameOver()) {
+                game.reset(new BreakoutGame(0, 0, width, height, 1e6f, 1 << 30, seed + frame, rows));
+            }
+        };
+
+        FrameStats updateStats(frames);
+        for (int f = 0; f < frames; f++) {
+            nextGame(f);
+            int key = autopilotKey(*game);
+            updateStats.measure([&] {
+                if (key != ERR) {
+                    game->handleInput(key, kSimStep);
+                }
+                game->update(kSimStep);
+            });
+        }
+        updateStats.print("update", scale, blockCount);
+
+        NullRenderer nullOut(width + 2, height + 3);
+        FramebufferRenderer frameOut(width + 2, height + 3);
+        AnsiRenderer ansiOut(-1, width + 2, height + 3, AnsiRenderer::Features{true, false});
+        Renderer* targets[] = {&nullOut, &frameOut, &ansiOut};
+        const char* names[] = {"render/null", "render/framebuffer", "render/ansi"};
+
+        for (int t = 0; t < 3; t++) {
+            game.reset();
+            FrameStats renderStats(frames);
+            for (int f = 0; f < frames; f++) {
+                nextGame(f);
+                game->update(kSimStep);
+                renderStats.measure([&] {
+                    game->render(*targets[t], 1.0f);
+                    targets[t]->present();
+                });
+            }
+            renderStats.print(names[t], scale, blockCount);
+        }
+        const AnsiRenderer::Counters& encodedTotals = ansiOut.getTotalCounters();
+        printf("  per frame, ansi encoder: attr switches %.1f  bytes %.1f\n",
+               static_cast<double>(encodedTotals.attrSwitches) / frames, static_cast<double>(encodedTotals.bytes) / frames);
+
+        // What a terminal would be sent for the same frames by ncurses' own
+        // update path and by the ANSI encoder, on an xterm
+        CursesCapture capture(width + 2, height + 3);
+        if (capture.isOpen()) {
+            initColors();
+            CursesRenderer cursesOut;
+            AnsiRenderer encoded(-1, width + 2, height + 3, AnsiRenderer::detectFeatures());
+            TeeRenderer both(cursesOut, encoded);
+            long long cursesStart = capture.getBytes();
+            game.reset();
+            for (int f = 0; f < frames; f++) {
+                nextGame(f);
+                game->update(kSimStep);
+                game->render(both, 1.0f);
+                both.present();
+            }
+            printf("  per frame: bytes ncurses %.1f  ansi %.1f\n",
+                   static_cast<double>(capture.getBytes() - cursesStart) / frames,
+                   static_cast<double>(encoded.getTotalCounters().bytes) / frames);
+        }
+    }
+
+    // Multi-ball stress: 10 to 10000 balls on a 780-block board, stepped on the
+    // calling thread and then spread over every core
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    ThreadPool pool(cores);
+    for (int threads : {1, cores}) {
+        for (int scale : kBenchScales) {
+            int ballCount = 10 * scale;
+            std::unique_ptr<BreakoutGame> game;
+            FrameStats ballStats(frames);
+            for (int f = 0; f < frames; f++) {
+                if (!game || game->isGameOver()) {
+                    game.reset(new BreakoutGame(0, 0, 240, 120, 1e6f, 1 << 30, seed + f, 20));
+                    game->addBalls(ballCount - 1);
+                    game->setThreadPool(threads > 1 ? &pool : nullptr);
+                }
+                ballStats.measure([&] { game->update(kSimStep); });
+            }
+
+            char name[32];
+            snprintf(name, sizeof(name), "balls/%dt", threads);
+            ballStats.print(name, scale, ballCount);
+        }
+        if (cores == 1) break;
+    }
+
+    // Ball-ball collisions: 100 to 100k balls on a board scaled with them, so
+    // the density stays about the same and the time per ball should too
+    for (int scale : kBenchScales) {
+        int ballCount = 100 * scale;
+        int width = static_cast<int>(120 * std::sqrt(static_cast<float>(scale)));
+        int height = width / 2;
+        std::unique_ptr<BreakoutGame> game;
+        FrameStats pairStats(frames);
+        for (int f = 0; f < frames; f++) {
+            if (!game || game->isGameOver()) {
+                game.reset(new BreakoutGame(0, 0, width, height, 1e6f, 1 << 30, seed + f, 5));
+                game->addBalls(ballCount - 1);
+                game->setThreadPool(cores > 1 ? &pool : nullptr);
+            }
+            pairStats.measure([&] { game->update(kSimStep); });
+        }
+        pairStats.print("balls/collide", scale, ballCount);
+    }
+
+    // One box against many: 64 ball-sized boxes a frame, each tested against
+    // every block of a board 64 blocks wide, first by GameObject::collidesWith
+    // one block at a time as the game's own code would, then by every overlap
+    // kernel this CPU runs on the same blocks packed into arrays. Every
+    // kernel's masks must match the collidesWith ones.
+    const int kProbes = 64;
+    printf("  aabb kernel picked at run time: %s\n", aabbKernelName(bestAabbKernel()));
+    for (int scale : kBenchScales) {
+        float cellWidth = BreakoutGame::kBlockWidth + BreakoutGame::kBlockSpacing;
+        float cellHeight = BreakoutGame::kBlockHeight + BreakoutGame::kBlockSpacing;
+        int boardWidth = static_cast<int>(64 * cellWidth) + 3;
+        BreakoutGame board(0, 0, boardWidth, static_cast<int>(scale * cellHeight) + 10, 1e6f, 1 << 30, seed, scale);
+        const BlockStore& blocks = board.getBlocks();
+        int targetCount = blocks.size();
+        int words = (targetCount + 31) / 32;
+
+        std::vector<GameObject> blockObjects;
+        std::vector<float> xs(targetCount), ys(targetCount), ws(targetCount), hs(targetCount);
+        blockObjects.reserve(targetCount);
+        for (int i = 0; i < targetCount; i++) {
+            xs[i] = static_cast<float>(blocks.getX(i));
+            ys[i] = static_cast<float>(blocks.getY(i));
+            ws[i] = static_cast<float>(blocks.getWidth(i));
+            hs[i] = static_cast<float>(blocks.getHeight(i));
+            blockObjects.push_back(GameObject(xs[i], ys[i], ws[i], hs[i]));
+        }
+        RandomSource random(seed);
+        std::vector<GameObject> probes;
+        for (int p = 0; p < kProbes; p++) {
+            probes.push_back(GameObject(random.nextInt(boardWidth * 4) / 4.0f,
+                                        random.nextInt(static_cast<int>(scale * cellHeight + 3) * 4) / 4.0f, 1, 1));
+        }
+
+        std::vector<uint32_t> expected(static_cast<size_t>(kProbes) * words), masks(expected.size());
+        FrameStats objectStats(frames);
+        long long expectedHits = 0;
+        for (int f = 0; f < frames; f++) {
+            objectStats.measure([&] {
+                std::fill(expected.begin(), expected.end(), 0u);
+                for (int p = 0; p < kProbes; p++) {
+                    uint32_t* mask = &expected[static_cast<size_t>(p) * words];
+                    for (int i = 0; i < targetCount; i++) {
+                        if (probes[p].collidesWith(blockObjects[i])) {
+                            mask[i / 32] |= uint32_t(1) << (i % 32);
+                            expectedHits++;
+                        }
+                    }
+                }
+            });
+        }
+        objectStats.print("aabb/collidesWith", scale, targetCount);
+
+        for (AabbKernel kernel : {AABB_SCALAR, AABB_SSE, AABB_AVX2}) {
+            if (!aabbKernelSupported(kernel)) continue;
+            AabbOverlapFn test = aabbKernel(kernel);
+            FrameStats kernelStats(frames);
+            long long hits = 0;
+            for (int f = 0; f < frames; f++) {
+                kernelStats.measure([&] {
+                    for (int p = 0; p < kProbes; p++) {
+                        Vector2D pos = probes[p].getPosition();
+                        hits += test(pos.x, pos.y, 1, 1, xs.data(), ys.data(), ws.data(), hs.data(), targetCount,
+                                     &masks[static_cast<size_t>(p) * words]);
+                    }
+                });
+            }
+
+            char name[32];
+            snprintf(name, sizeof(name), "aabb/%s", aabbKernelName(kernel));
+            kernelStats.print(name, scale, targetCount);
+            if (masks != expected || hits != expectedHits) {
+                printf("  %s masks differ from collidesWith\n", aabbKernelName(kernel));
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
+
+// Allocation check: plays games with the autopilot through the path the
+// interactive mode takes every frame (the steps, a snapshot published through
+// the triple buffer, the view drawing it for the terminal and into the ANSI
+// encoder) and fails if any frame allocates once its game has warmed up.
+// Games run without a block target so power-ups keep adding balls.
+int runAllocCheck(unsigned int seed, int frames, int ballCount) {
+    const int kWarmupFrames = 3; // One for each triple buffer slot to size itself
+    const int width = 60, height = 30;
+    NullRenderer terminal(width + 2, height + 3);
+    AnsiRenderer encoded(-1, width + 2, height + 3, AnsiRenderer::Features{true, true});
+    TeeRenderer out(terminal, encoded);
+    TripleBuffer<GameSnapshot> snapshots;
+    AllocCheck check;
+    int games = 0;
+
+    while (check.getFrames() < frames) {
+        BreakoutGame game(0, 0, width, height, 60.0f, 1 << 30, seed + games, 5);
+        game.addBalls(ballCount - 1);
+        BreakoutView view(0, 0, width, height);
+        games++;
+
+        for (int f = 0; !game.isGameOver() && check.getFrames() < frames; f++) {
+            auto frame = [&] {
+                int key = autopilotKey(game);
+                if (key != ERR) {
+                    game.handleInput(key, kHeadlessStepsPerFrame * kSimStep);
+                }
+                for (int step = 0; step < kHeadlessStepsPerFrame; step++) {
+                    game.update(kSimStep);
+                }
+                game.snapshot(snapshots.back());
+                snapshots.publish();
+                snapshots.update();
+                view.render(snapshots.front(), out, 1.0f);
+                out.present();
+            };
+            if (f < kWarmupFrames) {
+                frame();
+            } else {
+                check.measure(frame);
+            }
+        }
+    }
+
+    printf("games: %d\n", games);
+    return check.report(stdout, "alloc check");
+}
+
+// Replays a recorded session headlessly at full speed. The game is laid out
+// for the recorded terminal size and ball count exactly as main() does. In event-driven mode
+// the game is advanced from one recorded key straight to the next, which
+// plays out exactly as stepping does.
+int runReplay(const char* path, bool eventDriven) {
+    InputReplay replay;
+    if (!replay.open(path)) {
+        fprintf(stderr, "cannot read input log %s\n", path);
+        return 1;
+    }
+
+    BreakoutGame game(replay.getWidth() / 2 - 30, replay.getHeight() / 2 - 15, 60, 30, 60.0f, 10,
+                      replay.getSeed());
+    game.addBalls(std::max(1, replay.getBalls()) - 1);
+    long long step = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (!game.isGameOver() && !replay.finished(step)) {
+        replay.keysAt(step, [&](int key) { game.handleInput(key, kKeyMoveTime); });
+        if (eventDriven) {
+            long long nextStep = std::max(step + 1, replay.getNextStep());
+            step += game.advance(static_cast<int>(std::min<long long>(nextStep - step, INT_MAX)));
+        } else {
+            game.update(kSimStep);
+            step++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("seed: %u  steps: %lld  %s  score: %d  blocks: %d  state: %016llx\n", replay.getSeed(), step,
+           game.isGameOver() ? (game.isWin() ? "win" : "lose") : "quit", game.getScore(), game.getBlockHits(),
+           static_cast<unsigned long long>(game.stateHash()));
+    if (eventDriven) printf("ball steps swept: %lld of %lld\n", game.getBallSweeps(), game.getBallSteps());
+    printf("wall: %.3fs  steps/s: %.0f\n", seconds, seconds > 0 ? step / seconds : 0.0);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int headlessGames = 0;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    int benchFrames = 0;
+    int allocCheckFrames = 0;
+    unsigned int seed = static_cast<unsigned int>(time(nullptr));
+    bool verbose = false;
+    int boardWidth = 60, boardHeight = 30, blockRows = 5;
+    HeadlessRender renderMode = RENDER_NONE;
+    bool eventDriven = false;
+    int ballCount = 1, threadCount = 1;
+    double frameRate = 60.0;
+    bool frameStats = false;
+    bool inputStats = false;
+    bool ansiOutput = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headlessGames = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') headlessGames = atoi(argv[++i]);
+            if (headlessGames <= 0) {
+                fprintf(stderr, "--headless needs a positive game count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--board") == 0 && i + 3 < argc) {
+            boardWidth = atoi(argv[++i]);
+            boardHeight = atoi(argv[++i]);
+            blockRows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchFrames = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--alloc-check") == 0) {
+            allocCheckFrames = 10000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') allocCheckFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            i++;
+            renderMode = strcmp(argv[i], "null") == 0 ? RENDER_NULL
+                       : strcmp(argv[i], "framebuffer") == 0 ? RENDER_FRAMEBUFFER : RENDER_NONE;
+        } else if (strcmp(argv[i], "--events") == 0) {
+            eventDriven = true;
+        } else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc) {
+            ballCount = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            frameRate = std::max(1.0, atof(argv[++i]));
+        } else if (strcmp(argv[i], "--frame-stats") == 0) {
+            frameStats = true;
+        } else if (strcmp(argv[i], "--input-stats") == 0) {
+            inputStats = true;
+        } else if (strcmp(argv[i], "--ansi") == 0) {
+            ansiOutput = true;
+        } else {
+            fprintf(stderr, "usage: %s [--headless [games]] [--seed n] [--verbose] [--board width height rows]"
+                    " [--render none|null|framebuffer] [--events] [--balls n] [--threads n] [--bench [frames]]"
+                    " [--alloc-check [frames]] [--record file] [--replay file] [--rate fps] [--frame-stats] [--input-stats] [--ansi]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (benchFrames > 0) {
+        return runBenchmark(seed, benchFrames);
+    }
+
+    if (allocCheckFrames > 0) {
+        return runAllocCheck(seed, allocCheckFrames, ballCount);
+    }
+
+    if (replayPath) {
+        return runReplay(replayPath, eventDriven);
+    }
+
+    // Only worth having once there are many balls to step
+    ThreadPool pool(threadCount);
+    ThreadPool* threads = threadCount > 1 ? &pool : nullptr;
+
+    if (headlessGames > 0) {
+        return runHeadless(headlessGames, seed, verbose, boardWidth, boardHeight, blockRows, renderMode, eventDriven, ballCount, threads);
+    }
+
     initscr();
     cbreak();
     noecho();
@@ -423,53 +1462,146 @@ int main() {
     curs_set(0);
     nodelay(stdscr, TRUE);
 
-    if (has_colors()) {
-        start_color();
-        init_pair(1, COLOR_RED, COLOR_BLACK);    
-        init_pair(2, COLOR_WHITE, COLOR_BLUE);   
-        init_pair(3, COLOR_BLACK, COLOR_RED);    
-        init_pair(4, COLOR_BLACK, COLOR_YELLOW); 
-        init_pair(5, COLOR_BLACK, COLOR_GREEN);  
-        init_pair(6, COLOR_BLACK, COLOR_CYAN);   
-    }
+    initColors();
 
     int maxY, maxX;
     getmaxyx(stdscr, maxY, maxX);
 
-    BreakoutGame game(maxX / 2 - 30, maxY / 2 - 15, 60, 30, 60.0f, 10);
-    mvprintw(maxY - 3, 2, "Use LEFT/RIGHT arrows to move paddle");
-    mvprintw(maxY - 2, 2, "Press Q to quit");
-
-    float lastTime = static_cast<float>(clock()) / CLOCKS_PER_SEC;
-    bool running = true;
+    BreakoutGame game(maxX / 2 - 30, maxY / 2 - 15, 60, 30, 60.0f, 10, seed);
+    game.addBalls(ballCount - 1);
+    game.setThreadPool(threads);
+    // Frames go out through ncurses, or with --ansi through the encoder,
+    // which writes to the terminal itself
+    CursesRenderer terminal;
+    AnsiRenderer encoded(STDOUT_FILENO, maxX, maxY, AnsiRenderer::detectFeatures());
+    Renderer& renderer = ansiOutput ? static_cast<Renderer&>(encoded) : terminal;
+    if (ansiOutput) refresh(); // ncurses switches to the alternate screen on its first refresh
+
+    // Keys are logged with the number of steps run before they were applied
+    InputRecorder recorder;
+    if (recordPath && !recorder.open(recordPath, seed, maxX, maxY, ballCount)) {
+        endwin();
+        fprintf(stderr, "cannot write input log %s\n", recordPath);
+        return 1;
+    }
+    long long step = 0;
+
+    renderer.print(maxY - 3, 2, "Use LEFT/RIGHT arrows to move paddle");
+    renderer.print(maxY - 2, 2, "Press Q to quit");
+
+    // The simulation and the terminal run on separate threads. The simulation
+    // thread owns the game and the keys, and publishes a snapshot of the game
+    // after every change; the main thread draws the newest snapshot at the
+    // frame rate. A terminal write that blocks (a slow or stalled link) only
+    // holds up frames, never the game clock, and heavy steps only make frames
+    // show an older moment.
+    //
+    // The simulation runs in fixed kSimStep slices of wall-clock time; simTime
+    // is how far it has got. Each key is applied at the start of the step its
+    // timestamp falls in, which can be the step that is still in progress.
+    const std::chrono::steady_clock::duration simStep =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(kSimStep));
+    const std::chrono::steady_clock::duration maxCatchUp =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(kMaxFrameTime));
+    TripleBuffer<GameSnapshot> snapshots;
+    std::atomic<bool> simulating(true);
+    InputThread input;
+    LatencyHistogram inputLatency; // Key read to key applied
+
+    std::chrono::steady_clock::time_point simTime = std::chrono::steady_clock::now();
+    game.snapshot(snapshots.back());
+    snapshots.back().time = simTime;
+    snapshots.publish();
+    input.start();
+
+    std::thread simulation([&] {
+        bool running = true;
+        while (running && !game.isGameOver()) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now - simTime > maxCatchUp) simTime = now - maxCatchUp;
+            bool changed = false;
+
+            for (;;) {
+                const InputEvent* event;
+                while (running && (event = input.peek()) != nullptr && event->time < simTime + simStep) {
+                    int key = event->key;
+                    inputLatency.add(std::chrono::steady_clock::now() - event->time);
+                    input.pop();
+                    if (key == 'q' || key == 'Q') {
+                        running = false;
+                        break;
+                    }
+                    game.handleInput(key, kKeyMoveTime);
+                    recorder.record(step, key);
+                    changed = true;
+                }
+                if (!running || game.isGameOver() || simTime + simStep > now) break;
 
-    while (running && !game.isGameOver()) {
-        float currentTime = static_cast<float>(clock()) / CLOCKS_PER_SEC;
-        float deltaTime = currentTime - lastTime;
-        lastTime = currentTime;
+                game.update(kSimStep);
+                simTime += simStep;
+                step++;
+                changed = true;
+            }
 
-        int ch;
-        while ((ch = getch()) != ERR) {
-            if (ch == 'q' || ch == 'Q') {
-                running = false;
-                break;
+            if (changed) {
+                game.snapshot(snapshots.back());
+                snapshots.back().time = simTime;
+                snapshots.publish();
             }
-            game.handleInput(ch, deltaTime);
+
+            // Sleep until the next step is due, waking early for a key
+            input.wait(simTime + simStep);
+        }
+        simulating.store(false, std::memory_order_release);
+    });
+
+    // Frames late by more than one are dropped, not caught up: they would
+    // only draw the same snapshot again
+    FrameClock frameClock(frameRate, 0);
+    BreakoutView view(maxX / 2 - 30, maxY / 2 - 15, 60, 30);
+
+    bool settled = false; // The last frame drew the current snapshot at its end position
+    while (simulating.load(std::memory_order_acquire)) {
+        // With nothing published since a frame that already showed where the
+        // snapshot ends up, drawing again would only send the same frame
+        if (!snapshots.update() && settled) {
+            frameClock.sleep();
+            frameClock.tick();
+            continue;
         }
+        const GameSnapshot& state = snapshots.front();
+        float alpha = std::chrono::duration<float>(std::chrono::steady_clock::now() - state.time).count() / kSimStep;
+        alpha = std::min(1.0f, std::max(0.0f, alpha));
+        view.render(state, renderer, alpha);
+        settled = alpha >= 1.0f;
+        if (frameStats) {
+            char text[160];
+            frameClock.describe(text, sizeof(text));
+            renderer.print(maxY - 1, 2, "%s", text);
+        }
+        renderer.present();
 
-        game.update(deltaTime);
-        game.render();
-        refresh();
-        usleep(16667);  // ~60 FPS
+        frameClock.sleep();
+        frameClock.tick();
     }
 
+    simulation.join();
+    recorder.finish(step);
+    input.stop(); // Hands stdin back to getch()
+
     if (game.isGameOver()) {
-        game.render();
-        refresh();
+        snapshots.update();
+        view.render(snapshots.front(), renderer, 1.0f);
+        renderer.present();
         nodelay(stdscr, FALSE);
         getch();
     }
 
     endwin();
+    if (frameStats) frameClock.printStats(stdout);
+    if (inputStats) {
+        inputLatency.print(stdout, "input latency");
+        if (input.getDropped() > 0) printf("keys dropped: %lld\n", input.getDropped());
+    }
     return 0;
 }
@@ -0,0 +1,59 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity pool. Storage for `capacity` items is allocated once up
+// front and never grows; live items stay packed at the front so loops over
+// them are plain array walks, and a released slot is refilled by the last
+// live item (swap-and-pop). Spawning into a full pool is refused.
+template <typename T>
+class ObjectPool {
+private:
+    std::vector<T> items;
+    size_t capacity;
+    unsigned long long recycled; // Items released back to the pool
+    unsigned long long dropped;  // Spawns refused because the pool was full
+
+public:
+    explicit ObjectPool(size_t maxItems) : capacity(maxItems), recycled(0), dropped(0) {
+        items.reserve(capacity);
+    }
+
+    template <typename... Args>
+    bool spawn(Args&&... args) {
+        if (items.size() >= capacity) {
+            dropped++;
+            return false;
+        }
+        items.emplace_back(std::forward<Args>(args)...);
+        return true;
+    }
+
+    // The last live item moves into slot i, so callers iterating by index
+    // must look at slot i again after releasing it
+    void release(size_t i) {
+        items[i] = items.back();
+        items.pop_back();
+        recycled++;
+    }
+
+    void clear() { items.clear(); }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    typename std::vector<T>::iterator begin() { return items.begin(); }
+    typename std::vector<T>::iterator end() { return items.end(); }
+    typename std::vector<T>::const_iterator begin() const { return items.begin(); }
+    typename std::vector<T>::const_iterator end() const { return items.end(); }
+
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    size_t getCapacity() const { return capacity; }
+    unsigned long long getRecycled() const { return recycled; }
+    unsigned long long getDropped() const { return dropped; }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <vector>
+
+// Dense map from a screen cell to the slot of whatever occupies it, so
+// "is anything at (x, y)?" is a single array lookup. Empty cells and cells
+// outside the mapped area read as -1.
+class OccupancyGrid {
+private:
+    int originX, originY; // Screen position of cell (0, 0)
+    int width, height;
+    std::vector<int> cells;
+
+public:
+    OccupancyGrid() : originX(0), originY(0), width(0), height(0) {}
+
+    // Covers the w x h cells starting at (x, y) and empties them
+    void resize(int x, int y, int w, int h) {
+        originX = x;
+        originY = y;
+        width = w > 0 ? w : 0;
+        height = h > 0 ? h : 0;
+        cells.assign(static_cast<size_t>(width) * height, -1);
+    }
+
+    int get(int x, int y) const {
+        int cx = x - originX;
+        int cy = y - originY;
+        if (cx < 0 || cy < 0 || cx >= width || cy >= height) return -1;
+        return cells[cy * width + cx];
+    }
+
+    // Cells outside the mapped area are ignored
+    void set(int x, int y, int slot) {
+        int cx = x - originX;
+        int cy = y - originY;
+        if (cx < 0 || cy < 0 || cx >= width || cy >= height) return;
+        cells[cy * width + cx] = slot;
+    }
+
+    void clear(int x, int y) { set(x, y, -1); }
+};
+
+#endif
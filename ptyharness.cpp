@@ -0,0 +1,439 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench.h"
+
+// Drives a game binary the way a player on a terminal would, without one:
+// the game runs on a pseudo-terminal, scripted keys are typed into it, and
+// everything it writes is read back and timestamped. The report covers what
+// a link to the player would carry (bytes, bytes per frame, frame rate), how
+// long keys take to get a response, and how many read and write system
+// calls the game made (rw_syscalls; other calls are not counted).
+//
+//   ptyharness [--keys script] [--duration s] [--size colsxrows] [--gap ms] [--watch-row n]
+//              [--log file] game [args...]
+//
+// A script is a comma-separated list of time:key pairs, the time in seconds
+// from launch and the key a character or one of left, right, up, down,
+// space, enter, esc. The default taps the arrows and space for the whole
+// run and ends with q.
+//
+// Two latencies are reported. "Key to next output" runs from each key to the
+// first output after it. A game that redraws every frame writes something
+// each frame whatever the keys do, so this is mostly the frame interval and
+// says little about when the key took effect.
+//
+// "Key to screen" needs --watch-row, the screen row (from 0) the paddle or
+// player is drawn on. The harness follows the cursor through the output
+// stream, and each arrow key is timed to the first output that writes on
+// that row. An arrow that is followed by another before the row changes
+// counts as having no visible effect; a paddle that moves by less than a
+// cell, or is held against a wall, does this. Anything else drawn on the
+// row, such as a ball passing, also counts as a change. On a terminal of R
+// rows the rows are: main3 R/2+13, main4 and compile R/2+10, main 20, and
+// main2 R/2+6.
+
+typedef std::chrono::steady_clock Clock;
+
+struct ScriptedKey {
+    double time;
+    std::string bytes;
+};
+
+// Arrows are what moves the paddle or player, so they are the keys timed to
+// a change on the watched row
+bool isArrow(const std::string& bytes) {
+    return bytes.size() == 3 && bytes[0] == '\x1b' && bytes[2] >= 'A' && bytes[2] <= 'D';
+}
+
+// Follows the cursor through a terminal output stream far enough to tell
+// which rows text is written on. Understands what ncurses and the ANSI
+// encoder emit: absolute and relative cursor moves, CR, LF and backspace,
+// and the erase and repeat sequences, which write the current row. Other
+// escape sequences are skipped. Scrolling is not followed.
+class RowTracker {
+private:
+    enum State { TEXT, ESCAPE, CSI, CHARSET, OSC };
+
+    int cols, rows;
+    int row, col;
+    State state;
+    int params[8];
+    int paramCount;
+
+    void clampCursor() {
+        row = std::max(0, std::min(rows - 1, row));
+        col = std::max(0, std::min(cols - 1, col));
+    }
+
+    int param(int i, int fallback) const {
+        return i < paramCount && params[i] > 0 ? params[i] : fallback;
+    }
+
+    // Returns the row a CSI sequence wrote on, or -1
+    int finishCsi(char final) {
+        int wrote = -1;
+        switch (final) {
+            case 'H': case 'f': row = param(0, 1) - 1; col = param(1, 1) - 1; break;
+            case 'd': row = param(0, 1) - 1; break;
+            case 'G': case '`': col = param(0, 1) - 1; break;
+            case 'A': row -= param(0, 1); break;
+            case 'B': row += param(0, 1); break;
+            case 'C': col += param(0, 1); break;
+            case 'D': col -= param(0, 1); break;
+            case 'E': row += param(0, 1); col = 0; break;
+            case 'F': row -= param(0, 1); col = 0; break;
+            case 'K': case 'X': case 'b': case '@': case 'P': wrote = row; break;
+        }
+        clampCursor();
+        return wrote;
+    }
+
+public:
+    RowTracker(int cols, int rows)
+        : cols(std::max(1, cols)), rows(std::max(1, rows)), row(0), col(0), state(TEXT), params(), paramCount(0) {}
+
+    // Returns true when the bytes write anything on the given row. Sequences
+    // split across calls are carried over.
+    bool feed(const char* bytes, size_t length, int watchRow) {
+        bool wrote = false;
+        for (size_t i = 0; i < length; i++) {
+            unsigned char c = static_cast<unsigned char>(bytes[i]);
+            switch (state) {
+                case TEXT:
+                    if (c == 0x1b) {
+                        state = ESCAPE;
+                    } else if (c == '\r') {
+                        col = 0;
+                    } else if (c == '\n') {
+                        row = std::min(rows - 1, row + 1);
+                    } else if (c == '\b') {
+                        col = std::max(0, col - 1);
+                    } else if (c >= 0x20 && (c & 0xc0) != 0x80) { // UTF-8 continuation bytes share a cell
+                        if (row == watchRow) wrote = true;
+                        if (col < cols - 1) col++;
+                    }
+                    break;
+                case ESCAPE:
+                    if (c == '[') {
+                        state = CSI;
+                        paramCount = 0;
+                        params[0] = 0;
+                    } else if (c == '(' || c == ')') {
+                        state = CHARSET;
+                    } else if (c == ']') {
+                        state = OSC;
+                    } else {
+                        state = TEXT; // Two-byte sequences such as keypad modes
+                    }
+                    break;
+                case CSI:
+                    if (c >= '0' && c <= '9') {
+                        if (paramCount == 0) paramCount = 1;
+                        if (paramCount <= 8) params[paramCount - 1] = params[paramCount - 1] * 10 + (c - '0');
+                    } else if (c == ';') {
+                        if (paramCount == 0) paramCount = 1;
+                        if (paramCount < 8) params[paramCount] = 0;
+                        paramCount++;
+                    } else if (c >= 0x40 && c <= 0x7e) {
+                        paramCount = std::min(paramCount, 8);
+                        if (finishCsi(static_cast<char>(c)) == watchRow) wrote = true;
+                        state = TEXT;
+                    }
+                    break;
+                case CHARSET:
+                    state = TEXT;
+                    break;
+                case OSC:
+                    if (c == 0x07 || c == 0x1b) state = TEXT;
+                    break;
+            }
+        }
+        return wrote;
+    }
+};
+
+struct OutputChunk {
+    double time; // Seconds since launch
+    size_t offset, length; // Into the recorded stream
+};
+
+// Arrows are sent as an xterm in keypad mode sends them, which is the mode
+// the games switch it to
+bool keyBytes(const char* name, std::string& bytes) {
+    static const struct { const char* name; const char* bytes; } named[] = {
+        {"left", "\x1bOD"}, {"right", "\x1bOC"}, {"up", "\x1bOA"}, {"down", "\x1bOB"},
+        {"space", " "}, {"enter", "\r"}, {"esc", "\x1b"},
+    };
+    for (const auto& key : named) {
+        if (strcmp(name, key.name) == 0) {
+            bytes = key.bytes;
+            return true;
+        }
+    }
+    if (strlen(name) != 1) return false;
+    bytes = name;
+    return true;
+}
+
+bool parseScript(const char* text, std::vector<ScriptedKey>& keys) {
+    std::string script(text);
+    size_t start = 0;
+    while (start < script.size()) {
+        size_t end = script.find(',', start);
+        if (end == std::string::npos) end = script.size();
+        std::string item = script.substr(start, end - start);
+        size_t colon = item.find(':');
+        ScriptedKey key;
+        if (colon == std::string::npos || !keyBytes(item.c_str() + colon + 1, key.bytes)) return false;
+        key.time = atof(item.substr(0, colon).c_str());
+        keys.push_back(key);
+        start = end + 1;
+    }
+    return true;
+}
+
+std::vector<ScriptedKey> defaultScript(double duration) {
+    static const char* cycle[] = {"right", "right", "right", "left", "left", "left", "space"};
+    std::vector<ScriptedKey> keys;
+    int i = 0;
+    for (double t = 0.5; t < duration - 0.5; t += 0.25) {
+        ScriptedKey key = {t, ""};
+        keyBytes(cycle[i++ % 7], key.bytes);
+        keys.push_back(key);
+    }
+    keys.push_back(ScriptedKey{duration - 0.5, "q"});
+    return keys;
+}
+
+// Starts argv on a new pseudo-terminal of the given size as its controlling
+// terminal. Returns the master side, or -1.
+int launch(char* argv[], int cols, int rows, pid_t& pid) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+    const char* slaveName = ptsname(master);
+    if (!slaveName) return -1;
+
+    struct winsize size = {};
+    size.ws_row = static_cast<unsigned short>(rows);
+    size.ws_col = static_cast<unsigned short>(cols);
+
+    pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        setsid();
+        int slave = open(slaveName, O_RDWR);
+        if (slave < 0) _exit(127);
+        ioctl(slave, TIOCSCTTY, 0);
+        ioctl(slave, TIOCSWINSZ, &size);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO) close(slave);
+        close(master);
+        setenv("TERM", "xterm", 1);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    return master;
+}
+
+// Read and write system calls so far, from /proc. Counts every thread,
+// including ones that have exited. /proc has no count of the rest (poll,
+// nanosleep, futex, ioctl), so those show only through the context switches.
+bool readRwSyscalls(pid_t pid, long long& reads, long long& writes) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/io", static_cast<int>(pid));
+    FILE* io = fopen(path, "r");
+    if (!io) return false;
+    char line[128];
+    while (fgets(line, sizeof(line), io)) {
+        sscanf(line, "syscr: %lld", &reads);
+        sscanf(line, "syscw: %lld", &writes);
+    }
+    fclose(io);
+    return true;
+}
+
+// Reaps the game if it has exited, taking its read and write counts first
+// while it is still there to read them from
+bool reap(pid_t pid, long long& reads, long long& writes, struct rusage& usage) {
+    siginfo_t info = {};
+    if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != pid) return false;
+    readRwSyscalls(pid, reads, writes);
+    int status;
+    wait4(pid, &status, 0, &usage);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    double duration = 5.0;
+    double gapMs = 2.0; // Output separated by less than this is one frame
+    int watchRow = -1;  // Row whose changes time the arrow keys
+    int cols = 100, rows = 40;
+    const char* logPath = nullptr;
+    std::vector<ScriptedKey> keys;
+    bool scripted = false;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            if (!parseScript(argv[++i], keys)) {
+                fprintf(stderr, "bad key script: %s\n", argv[i]);
+                return 1;
+            }
+            scripted = true;
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = std::max(1.0, atof(argv[++i]));
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &cols, &rows) != 2) cols = 0;
+        } else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc) {
+            gapMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--watch-row") == 0 && i + 1 < argc) {
+            watchRow = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            logPath = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i >= argc || cols <= 0 || rows <= 0) {
+        fprintf(stderr, "usage: %s [--keys t:key,...] [--duration s] [--size colsxrows] [--gap ms] [--watch-row n] [--log file]"
+                " game [args...]\n", argv[0]);
+        return 1;
+    }
+    if (!scripted) keys = defaultScript(duration);
+
+    pid_t pid;
+    Clock::time_point start = Clock::now();
+    int master = launch(argv + i, cols, rows, pid);
+    if (master < 0) {
+        fprintf(stderr, "cannot start %s on a pty\n", argv[i]);
+        return 1;
+    }
+
+    std::string stream;
+    std::vector<OutputChunk> chunks;
+    std::vector<double> keyTimes; // When each scripted key went in, in order
+    LatencyHistogram outputLatency; // Key typed to the first output after it
+    LatencyHistogram screenLatency; // Arrow typed to the first write on the watched row
+    RowTracker tracker(cols, rows);
+    size_t nextKey = 0, waitingKey = 0;
+    double arrowTime = -1.0;        // Latest arrow still waiting for the watched row to change
+    long long arrowsTimed = 0, arrowsUnseen = 0;
+    long long rwSyscallReads = 0, rwSyscallWrites = 0;
+    bool exited = false;
+    struct rusage usage = {};
+    double hardStop = duration + 1.0; // Time allowed after the last key to quit on its own
+
+    for (;;) {
+        double now = std::chrono::duration<double>(Clock::now() - start).count();
+        if (now >= hardStop) break;
+
+        while (nextKey < keys.size() && keys[nextKey].time <= now) {
+            ssize_t ignored = write(master, keys[nextKey].bytes.data(), keys[nextKey].bytes.size());
+            (void)ignored;
+            keyTimes.push_back(now);
+            if (watchRow >= 0 && isArrow(keys[nextKey].bytes)) {
+                if (arrowTime >= 0) arrowsUnseen++; // Superseded before anything changed
+                arrowTime = now;
+            }
+            nextKey++;
+        }
+        readRwSyscalls(pid, rwSyscallReads, rwSyscallWrites);
+
+        double wake = hardStop;
+        if (nextKey < keys.size()) wake = std::min(wake, keys[nextKey].time);
+        struct pollfd output = {master, POLLIN, 0};
+        int timeoutMs = static_cast<int>(std::max(0.0, (wake - now) * 1000.0)) + 1;
+        if (poll(&output, 1, std::min(timeoutMs, 50)) > 0) {
+            char buffer[65536];
+            ssize_t got = read(master, buffer, sizeof(buffer));
+            if (got <= 0) break; // The game has gone and closed the terminal
+            double when = std::chrono::duration<double>(Clock::now() - start).count();
+            chunks.push_back(OutputChunk{when, stream.size(), static_cast<size_t>(got)});
+            stream.append(buffer, static_cast<size_t>(got));
+            for (; waitingKey < keyTimes.size(); waitingKey++) {
+                outputLatency.add(std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(when - keyTimes[waitingKey])));
+            }
+            if (tracker.feed(buffer, static_cast<size_t>(got), watchRow) && arrowTime >= 0) {
+                screenLatency.add(std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(when - arrowTime)));
+                arrowsTimed++;
+                arrowTime = -1.0;
+            }
+        }
+
+        if (reap(pid, rwSyscallReads, rwSyscallWrites, usage)) {
+            exited = true;
+            break;
+        }
+    }
+
+    // A game that closed the terminal is on its way out; one still running
+    // after the script is stopped
+    for (int tries = 0; !exited && tries < 50; tries++) {
+        usleep(10000);
+        exited = reap(pid, rwSyscallReads, rwSyscallWrites, usage);
+    }
+    if (!exited) {
+        kill(pid, SIGKILL);
+        int status;
+        wait4(pid, &status, 0, &usage);
+    }
+    close(master);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Frames: bursts of output with less than the gap between chunks
+    long long frames = 0;
+    double lastChunk = -1.0;
+    for (const OutputChunk& chunk : chunks) {
+        if (lastChunk < 0 || (chunk.time - lastChunk) * 1000.0 >= gapMs) frames++;
+        lastChunk = chunk.time;
+    }
+    double active = chunks.empty() ? 0.0 : chunks.back().time - chunks.front().time;
+
+    if (logPath) {
+        FILE* log = fopen(logPath, "wb");
+        if (!log) {
+            fprintf(stderr, "cannot write %s\n", logPath);
+        } else {
+            // Each chunk: "@seconds length" on a line, then the raw bytes
+            for (const OutputChunk& chunk : chunks) {
+                fprintf(log, "@%.6f %zu\n", chunk.time, chunk.length);
+                fwrite(stream.data() + chunk.offset, 1, chunk.length, log);
+                fputc('\n', log);
+            }
+            fclose(log);
+        }
+    }
+
+    printf("game: %s", argv[i]);
+    for (int a = i + 1; a < argc; a++) printf(" %s", argv[a]);
+    printf("  (%dx%d, %s after %.2f s)\n", cols, rows, exited ? "exited" : "killed", elapsed);
+    printf("output: %zu bytes in %zu reads  %lld frames with output  %.1f fps  %.1f bytes/frame  %.0f bytes/s\n", stream.size(),
+           chunks.size(), frames, active > 0 ? (frames - 1) / active : 0.0,
+           frames > 0 ? static_cast<double>(stream.size()) / frames : 0.0, active > 0 ? stream.size() / active : 0.0);
+    printf("rw_syscalls: %lld read  %lld write  context switches: %ld voluntary  %ld involuntary\n", rwSyscallReads,
+           rwSyscallWrites, usage.ru_nvcsw, usage.ru_nivcsw);
+    printf("keys: %zu sent\n", keyTimes.size());
+    outputLatency.print(stdout, "key to next output");
+    if (watchRow >= 0) {
+        if (arrowTime >= 0) arrowsUnseen++;
+        printf("arrows: %lld changed row %d, %lld did not\n", arrowsTimed, watchRow, arrowsUnseen);
+        screenLatency.print(stdout, "key to screen");
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef RANDOM_SOURCE_H
+#define RANDOM_SOURCE_H
+
+#include <cstdint>
+
+// Small seedable PRNG (xorshift64*). Each game owns one, so a run can be
+// reproduced from its seed regardless of what else calls rand().
+class RandomSource {
+private:
+    uint64_t state;
+
+public:
+    explicit RandomSource(uint32_t seed) : state((seed + 1ULL) * 0x9E3779B97F4A7C15ULL) {}
+
+    uint32_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<uint32_t>((state * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    // Uniform-ish integer in [0, n)
+    int nextInt(int n) { return static_cast<int>(next() % static_cast<uint32_t>(n)); }
+};
+
+#endif
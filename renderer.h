@@ -0,0 +1,240 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <ncursesw/ncurses.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Output target for all draw code. Cells are ncurses chtypes, so a glyph
+// carries its own attributes (ch | COLOR_PAIR(n) | A_BOLD ...) and draw code
+// never has to toggle attron/attroff around it.
+class Renderer {
+public:
+    virtual ~Renderer() {}
+
+    virtual void putChar(int y, int x, chtype ch) = 0;
+    virtual void putText(int y, int x, chtype attrs, const char* text) = 0;
+    virtual void clearToEol(int y, int x) = 0;
+    // Ends the frame; the ncurses backend refreshes the terminal here
+    virtual void present() = 0;
+
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+
+    // printf-style helpers on top of putText, returning the length written
+    int print(int y, int x, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int length = vprint(y, x, A_NORMAL, format, args);
+        va_end(args);
+        return length;
+    }
+
+    int printAttr(int y, int x, chtype attrs, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int length = vprint(y, x, attrs, format, args);
+        va_end(args);
+        return length;
+    }
+
+private:
+    int vprint(int y, int x, chtype attrs, const char* format, va_list args) {
+        char text[256];
+        int length = vsnprintf(text, sizeof(text), format, args);
+        putText(y, x, attrs, text);
+        return length < static_cast<int>(sizeof(text)) ? length : static_cast<int>(sizeof(text)) - 1;
+    }
+};
+
+// Draws straight to stdscr; needs initscr() to have run
+class CursesRenderer : public Renderer {
+public:
+    void putChar(int y, int x, chtype ch) override {
+        mvaddch(y, x, ch);
+    }
+
+    void putText(int y, int x, chtype attrs, const char* text) override {
+        attron(attrs);
+        mvaddstr(y, x, text);
+        attroff(attrs);
+    }
+
+    void clearToEol(int y, int x) override {
+        move(y, x);
+        clrtoeol();
+    }
+
+    void present() override {
+        refresh();
+    }
+
+    int getWidth() const override { return COLS; }
+    int getHeight() const override { return LINES; }
+};
+
+// An ncurses screen of a given size whose output goes to a scratch file
+// instead of the terminal, so the bytes its update path would send can be
+// counted. While it exists it is the current screen, and CursesRenderer draws
+// on it.
+class CursesCapture {
+private:
+    FILE* output;
+    FILE* input;
+    SCREEN* screen;
+
+public:
+    CursesCapture(int width, int height, const char* terminal = "xterm")
+        : output(tmpfile()), input(fopen("/dev/null", "r")), screen(nullptr) {
+        if (output && input) screen = newterm(terminal, output, input);
+        if (screen) resizeterm(height, width);
+    }
+
+    ~CursesCapture() {
+        if (screen) {
+            endwin();
+            delscreen(screen);
+        }
+        if (output) fclose(output);
+        if (input) fclose(input);
+    }
+
+    CursesCapture(const CursesCapture&) = delete;
+    CursesCapture& operator=(const CursesCapture&) = delete;
+
+    // False when there is no terminfo entry for the terminal
+    bool isOpen() const { return screen != nullptr; }
+
+    // Everything ncurses has sent so far
+    long long getBytes() const {
+        struct stat info;
+        fflush(output);
+        return fstat(fileno(output), &info) == 0 ? static_cast<long long>(info.st_size) : 0;
+    }
+};
+
+// Sends every call to two renderers, to compare back ends on the same frames
+class TeeRenderer : public Renderer {
+private:
+    Renderer& first;
+    Renderer& second;
+
+public:
+    TeeRenderer(Renderer& first, Renderer& second) : first(first), second(second) {}
+
+    void putChar(int y, int x, chtype ch) override {
+        first.putChar(y, x, ch);
+        second.putChar(y, x, ch);
+    }
+
+    void putText(int y, int x, chtype attrs, const char* text) override {
+        first.putText(y, x, attrs, text);
+        second.putText(y, x, attrs, text);
+    }
+
+    void clearToEol(int y, int x) override {
+        first.clearToEol(y, x);
+        second.clearToEol(y, x);
+    }
+
+    void present() override {
+        first.present();
+        second.present();
+    }
+
+    int getWidth() const override { return std::min(first.getWidth(), second.getWidth()); }
+    int getHeight() const override { return std::min(first.getHeight(), second.getHeight()); }
+};
+
+// In-memory grid of cells. Frames can be compared cell by cell or hashed,
+// which makes rendering testable and measurable without a terminal.
+class FramebufferRenderer : public Renderer {
+private:
+    int width, height;
+    std::vector<chtype> cells; // Row-major, ' ' when empty
+    int frames;
+
+public:
+    FramebufferRenderer(int w, int h) : width(w), height(h), cells(static_cast<size_t>(w) * h, ' '), frames(0) {}
+
+    void putChar(int y, int x, chtype ch) override {
+        if (x < 0 || y < 0 || x >= width || y >= height) return;
+        cells[y * width + x] = ch;
+    }
+
+    void putText(int y, int x, chtype attrs, const char* text) override {
+        for (; *text != '\0'; text++, x++) {
+            putChar(y, x, static_cast<unsigned char>(*text) | attrs);
+        }
+    }
+
+    void clearToEol(int y, int x) override {
+        for (; x < width; x++) {
+            putChar(y, x, ' ');
+        }
+    }
+
+    void present() override { frames++; }
+
+    void clear() { std::fill(cells.begin(), cells.end(), ' '); }
+
+    chtype at(int y, int x) const {
+        if (x < 0 || y < 0 || x >= width || y >= height) return ' ';
+        return cells[y * width + x];
+    }
+
+    // Number of cells that differ from another framebuffer of the same size
+    int diff(const FramebufferRenderer& other) const {
+        int changed = 0;
+        for (size_t i = 0; i < cells.size() && i < other.cells.size(); i++) {
+            if (cells[i] != other.cells[i]) changed++;
+        }
+        return changed;
+    }
+
+    // 64-bit FNV-1a over every cell
+    uint64_t hash() const {
+        uint64_t h = 1469598103934665603ULL;
+        for (chtype cell : cells) {
+            for (size_t i = 0; i < sizeof(cell); i++) {
+                h ^= (cell >> (i * 8)) & 0xff;
+                h *= 1099511628211ULL;
+            }
+        }
+        return h;
+    }
+
+    int getWidth() const override { return width; }
+    int getHeight() const override { return height; }
+    int getFrames() const { return frames; }
+};
+
+// Discards everything, only counting what it was asked to draw. Used to time
+// the draw code itself with no output cost.
+class NullRenderer : public Renderer {
+private:
+    int width, height;
+    long long cellsDrawn;
+
+public:
+    NullRenderer(int w, int h) : width(w), height(h), cellsDrawn(0) {}
+
+    void putChar(int, int, chtype) override { cellsDrawn++; }
+    void putText(int, int, chtype, const char* text) override {
+        for (; *text != '\0'; text++) cellsDrawn++;
+    }
+    void clearToEol(int, int x) override {
+        if (x < width) cellsDrawn += width - x;
+    }
+    void present() override {}
+
+    int getWidth() const override { return width; }
+    int getHeight() const override { return height; }
+    long long getCellsDrawn() const { return cellsDrawn; }
+};
+
+#endif
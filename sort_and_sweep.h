@@ -0,0 +1,128 @@
+#ifndef SORT_AND_SWEEP_H
+#define SORT_AND_SWEEP_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+// Sort-and-sweep broadphase for moving boxes. Boxes are bucketed into
+// horizontal bands and kept sorted by band and then left edge, so a box is
+// only tested against boxes in its own band and the band below that start
+// before it ends. A plain one-axis sweep would test every box against all the
+// boxes in its column across the whole board.
+//
+// The sorted list is kept from one call to the next and repaired with an
+// insertion sort, which is close to linear when the boxes have only moved a
+// little since the previous frame. Boxes are stored in that order too, so
+// the sweep reads memory front to back.
+class SortAndSweep {
+private:
+    struct Entry {
+        float minX, minY, maxX, maxY;
+        int band;
+        int id;
+
+        bool before(const Entry& other) const {
+            return band < other.band || (band == other.band && minX < other.minX);
+        }
+    };
+
+    float bandHeight;
+    std::vector<Entry> entries; // Sorted by band then minX, carried between calls
+    std::vector<Entry> boxes;   // Indexed by id, filled in id order so bounds() reads its source in order
+    long long tests;            // Box pairs compared by the last call
+
+public:
+    // No box may be taller than a band
+    explicit SortAndSweep(float bandHeight = 1.0f) : bandHeight(bandHeight), tests(0) {}
+
+    // Makes room for count boxes, so calls with up to that many never allocate
+    void reserve(int count) {
+        entries.reserve(count);
+        boxes.reserve(count);
+    }
+
+    // bounds(id, minX, minY, maxX, maxY) fills in box id for ids 0..count-1.
+    // Calls overlap(a, b) once for every pair of boxes that overlap, with a
+    // before b in the sorted order. Ids may be renumbered between calls (boxes
+    // removed or added); the old order is then only a starting point.
+    template <typename Bounds, typename Overlap>
+    void findPairs(int count, Bounds bounds, Overlap overlap) {
+        boxes.resize(count);
+        for (int id = 0; id < count; id++) {
+            Entry& box = boxes[id];
+            bounds(id, box.minX, box.minY, box.maxX, box.maxY);
+            box.band = static_cast<int>(std::floor(box.minY / bandHeight));
+            box.id = id;
+        }
+
+        // Drop ids that no longer exist, append new ones and refresh the rest
+        size_t kept = 0;
+        for (const Entry& entry : entries) {
+            if (entry.id < count) entries[kept++] = entry;
+        }
+        entries.resize(kept);
+        for (int id = static_cast<int>(kept); id < count; id++) {
+            entries.push_back(boxes[id]);
+        }
+        for (Entry& entry : entries) {
+            entry = boxes[entry.id];
+        }
+
+        // A mostly new set of boxes is sorted from scratch; otherwise the
+        // insertion sort only has to move the few that changed place
+        if (count - kept > kept / 4) {
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+                return a.before(b) || (!b.before(a) && a.id < b.id);
+            });
+        }
+        for (size_t i = 1; i < entries.size(); i++) {
+            Entry entry = entries[i];
+            size_t j = i;
+            for (; j > 0 && entry.before(entries[j - 1]); j--) {
+                entries[j] = entries[j - 1];
+            }
+            entries[j] = entry;
+        }
+
+        long long compared = 0;
+        size_t n = entries.size();
+        size_t below = 0;    // First entry past the current band
+        size_t belowX = 0;   // First entry in the band below that can still reach the current box
+        int band = INT_MIN;
+        for (size_t i = 0; i < n; i++) {
+            const Entry& a = entries[i];
+            if (a.band != band) {
+                band = a.band;
+                below = std::max(below, i);
+                while (below < n && entries[below].band == band) below++;
+                belowX = below;
+            }
+
+            // Same band, boxes starting between this box's edges
+            for (size_t j = i + 1; j < below; j++) {
+                const Entry& b = entries[j];
+                if (b.minX >= a.maxX) break;
+                compared++;
+                if (a.minY < b.maxY && b.minY < a.maxY) overlap(a.id, b.id);
+            }
+
+            // Band below. Boxes there that end before this one starts also end
+            // before every later box in this band starts, so they are skipped
+            // for good.
+            while (belowX < n && entries[belowX].band == band + 1 && entries[belowX].maxX <= a.minX) belowX++;
+            for (size_t j = belowX; j < n && entries[j].band == band + 1; j++) {
+                const Entry& b = entries[j];
+                if (b.minX >= a.maxX) break;
+                compared++;
+                if (a.minY < b.maxY && b.minY < a.maxY) overlap(a.id, b.id);
+            }
+        }
+        tests = compared;
+    }
+
+    long long getTests() const { return tests; }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Uniform grid over the play area. Every cell keeps the ids of the rectangles
+// that overlap it, so a query only has to look at the few cells it touches
+// instead of every block on the board.
+class SpatialGrid {
+private:
+    float originX, originY;   // Top-left corner of the indexed area
+    float cellWidth, cellHeight;
+    int cols, rows;
+    std::vector<std::vector<int>> cells; // Row-major, cols * rows buckets
+
+    // Rectangles outside the area are clamped onto the border cells, so
+    // queries stay correct (just less selective) for anything off the grid.
+    int cellX(float x) const {
+        int cx = static_cast<int>(std::floor((x - originX) / cellWidth));
+        return cx < 0 ? 0 : (cx >= cols ? cols - 1 : cx);
+    }
+
+    int cellY(float y) const {
+        int cy = static_cast<int>(std::floor((y - originY) / cellHeight));
+        return cy < 0 ? 0 : (cy >= rows ? rows - 1 : cy);
+    }
+
+public:
+    SpatialGrid() : originX(0), originY(0), cellWidth(1), cellHeight(1), cols(1), rows(1), cells(1) {}
+
+    SpatialGrid(float x, float y, float width, float height, float cellW, float cellH) : SpatialGrid() {
+        resize(x, y, width, height, cellW, cellH);
+    }
+
+    // Re-lays the grid over a new area and empties it
+    void resize(float x, float y, float width, float height, float cellW, float cellH) {
+        originX = x;
+        originY = y;
+        cellWidth = cellW > 0 ? cellW : 1.0f;
+        cellHeight = cellH > 0 ? cellH : 1.0f;
+        cols = std::max(1, static_cast<int>(std::ceil(width / cellWidth)));
+        rows = std::max(1, static_cast<int>(std::ceil(height / cellHeight)));
+        cells.resize(static_cast<size_t>(cols) * rows);
+        clear();
+    }
+
+    // Empties every cell but keeps their storage for the next fill
+    void clear() {
+        for (auto& cell : cells) {
+            cell.clear();
+        }
+    }
+
+    void insert(int id, float x, float y, float w, float h) {
+        int x0 = cellX(x), x1 = cellX(x + w);
+        int y0 = cellY(y), y1 = cellY(y + h);
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                cells[cy * cols + cx].push_back(id);
+            }
+        }
+    }
+
+    // The rectangle must be the one the id was inserted with
+    void remove(int id, float x, float y, float w, float h) {
+        int x0 = cellX(x), x1 = cellX(x + w);
+        int y0 = cellY(y), y1 = cellY(y + h);
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                std::vector<int>& cell = cells[cy * cols + cx];
+                for (size_t i = 0; i < cell.size(); i++) {
+                    if (cell[i] == id) {
+                        cell[i] = cell.back(); // Order inside a cell does not matter
+                        cell.pop_back();
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // Calls visit(id) for every id in the cells the rectangle overlaps. An id
+    // spanning several of those cells is visited once per cell.
+    template <typename Visitor>
+    void query(float x, float y, float w, float h, Visitor visit) const {
+        int x0 = cellX(x), x1 = cellX(x + w);
+        int y0 = cellY(y), y1 = cellY(y + h);
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                for (int id : cells[cy * cols + cx]) {
+                    visit(id);
+                }
+            }
+        }
+    }
+
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+};
+
+#endif
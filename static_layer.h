@@ -0,0 +1,82 @@
+#ifndef STATIC_LAYER_H
+#define STATIC_LAYER_H
+
+#include "renderer.h"
+#include <vector>
+
+// Off-screen copy of the parts of the screen that only change on events
+// (borders, blocks). Draw code renders into it like any other target; flush()
+// then copies just the cells that changed since the last flush to the real
+// output, so a frame with no hits costs nothing for the static content.
+// Sprites moving off a cell restore() it from here instead of blanking it, so
+// a ball grazing a block never punches a hole in it.
+class StaticLayer : public Renderer {
+private:
+    int originX, originY; // Screen position of cell (0, 0)
+    int width, height;
+    std::vector<chtype> cells; // Row-major, 0 where nothing static is drawn
+    std::vector<int> dirty;    // Cells changed since the last flush, each once, so never more than cells
+    std::vector<unsigned char> isDirty; // By cell, set while it is in dirty
+
+    int index(int y, int x) const {
+        x -= originX;
+        y -= originY;
+        if (x < 0 || y < 0 || x >= width || y >= height) return -1;
+        return y * width + x;
+    }
+
+public:
+    // Covers the screen rectangle at (x, y) of size w by h
+    StaticLayer(int x, int y, int w, int h)
+        : originX(x), originY(y), width(w), height(h), cells(static_cast<size_t>(w) * h, 0),
+          isDirty(cells.size(), 0) {
+        dirty.reserve(cells.size());
+    }
+
+    void putChar(int y, int x, chtype ch) override {
+        int i = index(y, x);
+        if (i < 0 || cells[i] == ch) return;
+        cells[i] = ch;
+        if (isDirty[i]) return;
+        isDirty[i] = 1;
+        dirty.push_back(i);
+    }
+
+    void putText(int y, int x, chtype attrs, const char* text) override {
+        for (; *text != '\0'; text++, x++) {
+            putChar(y, x, static_cast<unsigned char>(*text) | attrs);
+        }
+    }
+
+    void clearToEol(int y, int x) override {
+        for (; x < originX + width; x++) {
+            putChar(y, x, ' ');
+        }
+    }
+
+    void present() override {}
+
+    // Copies every cell changed since the last flush to out
+    void flush(Renderer& out) {
+        for (int i : dirty) {
+            out.putChar(originY + i / width, originX + i % width, cells[i]);
+            isDirty[i] = 0;
+        }
+        dirty.clear();
+    }
+
+    // Puts back whatever static content belongs at (y, x), or a blank
+    void restore(Renderer& out, int y, int x) const {
+        out.putChar(y, x, at(y, x));
+    }
+
+    chtype at(int y, int x) const {
+        int i = index(y, x);
+        return i < 0 || cells[i] == 0 ? ' ' : cells[i];
+    }
+
+    int getWidth() const override { return originX + width; }
+    int getHeight() const override { return originY + height; }
+};
+
+#endif
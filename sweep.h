@@ -0,0 +1,64 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <algorithm>
+#include <cmath>
+
+// Continuous collision for a ball that travels a whole step at once. Rather than
+// moving first and checking for overlap afterwards, which lets a fast ball jump
+// clean over a thin block or out through a wall, the move is treated as a ray
+// and the exact fraction of it travelled before first contact is found.
+
+// First contact along a move. time is the fraction of the move (0..1) travelled
+// before touching; reflectX says the contact face is vertical, so the x velocity
+// is the component that reflects (otherwise y does).
+struct SweepHit {
+    float time;
+    bool reflectX;
+};
+
+// Entry and exit times of p + t * d through the open interval (lo, hi).
+// Returns false when the ray runs parallel to the slab outside of it.
+inline bool sweepSlab(float p, float d, float lo, float hi, float& enter, float& exit) {
+    if (d == 0.0f) {
+        if (p <= lo || p >= hi) return false;
+        enter = -INFINITY;
+        exit = INFINITY;
+        return true;
+    }
+    float t0 = (lo - p) / d;
+    float t1 = (hi - p) / d;
+    enter = std::min(t0, t1);
+    exit = std::max(t0, t1);
+    return true;
+}
+
+// Point (px, py) moving by (dx, dy) against the box [minX, maxX] x [minY, maxY].
+// A moving rectangle can be swept the same way by growing the box by its size.
+// Only entering counts: a ray that starts inside or on a face and moves away
+// is not a hit, so a ball resting against the block it just bounced off is
+// not caught a second time. Fills hit when contact comes before maxTime.
+inline bool sweepBox(float px, float py, float dx, float dy,
+                     float minX, float minY, float maxX, float maxY, float maxTime, SweepHit& hit) {
+    float enterX, exitX, enterY, exitY;
+    if (!sweepSlab(px, dx, minX, maxX, enterX, exitX)) return false;
+    if (!sweepSlab(py, dy, minY, maxY, enterY, exitY)) return false;
+
+    float enter = std::max(enterX, enterY);
+    float exit = std::min(exitX, exitY);
+    if (enter >= exit || enter < 0.0f || enter >= maxTime) return false;
+
+    hit.time = enter;
+    hit.reflectX = enterX > enterY;
+    return true;
+}
+
+// Fraction of a move of d until p, inside [lo, hi], reaches the bound it is
+// heading for. A point already past that bound reaches it at once.
+inline float sweepBounds(float p, float d, float lo, float hi) {
+    if (d < 0.0f) return std::max(0.0f, (lo - p) / d);
+    if (d > 0.0f) return std::max(0.0f, (hi - p) / d);
+    return INFINITY;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. parallelFor splits a
+// range into one contiguous chunk per thread, runs the first chunk on the
+// calling thread and returns once every chunk is done. Chunk boundaries depend
+// only on the range and the thread count, never on timing.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;  // Workers wait here for the next loop
+    std::condition_variable done;  // parallelFor waits here for the workers
+    void* task;                    // The loop body, called through invoke
+    void (*invoke)(void* task, int begin, int end);
+    int itemCount;
+    int pending;                   // Workers still busy with the current loop
+    unsigned int generation;       // Bumped for every loop so workers see new work
+    bool stopping;
+
+    int chunkStart(int chunk) const {
+        return static_cast<int>(static_cast<long long>(itemCount) * chunk / (workers.size() + 1));
+    }
+
+    void workerLoop(int chunk) {
+        unsigned int seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+
+            int begin = chunkStart(chunk);
+            int end = chunkStart(chunk + 1);
+            lock.unlock();
+            if (begin < end) invoke(task, begin, end);
+            lock.lock();
+
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+public:
+    // threads counts the caller, so ThreadPool(1) starts no workers at all
+    explicit ThreadPool(int threads)
+        : task(nullptr), invoke(nullptr), itemCount(0), pending(0), generation(0), stopping(false) {
+        for (int i = 1; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls body(begin, end) over disjoint chunks covering [0, count)
+    template <typename Body>
+    void parallelFor(int count, Body body) {
+        if (workers.empty() || count < 2) {
+            if (count > 0) body(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &body;
+            invoke = [](void* t, int begin, int end) { (*static_cast<Body*>(t))(begin, end); };
+            itemCount = count;
+            pending = static_cast<int>(workers.size());
+            generation++;
+        }
+        wake.notify_all();
+
+        int end = chunkStart(1);
+        if (end > 0) body(0, end);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return pending == 0; });
+    }
+
+    int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+};
+
+#endif
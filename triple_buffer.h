@@ -0,0 +1,53 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the latest value from exactly one producer thread to exactly one
+// consumer thread without either ever waiting on the other. There are three
+// slots: the producer fills its back slot and publish() swaps it with the
+// shared middle one; the consumer's update() swaps its front slot with the
+// middle one when something new has been published since. Values the consumer
+// was too slow to see are simply overwritten, which is what a renderer wants
+// from a simulation: the newest state, never a queue of stale ones.
+//
+// Slots are reused rather than rebuilt, so a T holding vectors keeps their
+// capacity from one round to the next.
+template <typename T>
+class TripleBuffer {
+private:
+    static const unsigned kFresh = 4; // Set in shared when the middle slot holds a value not yet taken
+
+    T slots[3];
+    alignas(64) std::atomic<unsigned> shared; // Index of the middle slot, plus kFresh
+    alignas(64) unsigned writing;             // Producer's slot
+    alignas(64) unsigned reading;             // Consumer's slot
+
+public:
+    TripleBuffer() : slots(), shared(1), writing(0), reading(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side: the slot to fill. Holds whatever was last written into
+    // it, not necessarily the last value published.
+    T& back() { return slots[writing]; }
+
+    // Producer side: makes back() the newest value and takes another slot
+    void publish() {
+        writing = shared.exchange(writing | kFresh, std::memory_order_acq_rel) & ~kFresh;
+    }
+
+    // Consumer side: moves front() on to the newest value. Returns false when
+    // nothing has been published since the last call.
+    bool update() {
+        if (!(shared.load(std::memory_order_relaxed) & kFresh)) return false;
+        reading = shared.exchange(reading, std::memory_order_acq_rel) & ~kFresh;
+        return true;
+    }
+
+    // Consumer side: stays put until the next update()
+    const T& front() const { return slots[reading]; }
+};
+
+#endif